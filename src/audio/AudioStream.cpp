@@ -6,7 +6,10 @@
  */
 
 #include "AudioStream.h"
+#include "capture/InstantReplay.h"
+#include "capture/MediaCapture.h"
 #include "libretro/LibretroEnvironment.h"
+#include "utils/FrameProfiler.h"
 
 #include "client.h"
 
@@ -25,12 +28,21 @@ void CAudioStream::Initialize(CGameLibRetro* addon)
 
 void CAudioStream::Deinitialize()
 {
+  m_singleFrameAudio.Clear();
   m_stream.Close();
   m_addon = nullptr;
 }
 
 void CAudioStream::AddFrames_S16NE(const uint8_t* data, unsigned int size)
 {
+  if (!m_bEnabled)
+    return;
+
+  CFrameTimer audioTimer(FRAME_PHASE_AUDIO);
+
+  CMediaCapture::Get().AddAudioFrames(data, size);
+  CInstantReplay::Get().AddAudioFrames(data, size);
+
   if (m_addon && !m_stream.IsOpen())
   {
     static const GAME_AUDIO_CHANNEL channelMap[] = { GAME_CH_FL, GAME_CH_FR, GAME_CH_NULL };
@@ -25,13 +25,32 @@ namespace LIBRETRO
     void Initialize(CGameLibRetro* addon);
     void Deinitialize();
 
-    void AddFrame_S16NE(int16_t left, int16_t right) { m_singleFrameAudio.AddFrame(left, right); }
+    /*!
+     * \brief Enable or disable audio output
+     *
+     * While disabled, samples from the core are discarded.
+     */
+    void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+    bool IsEnabled() const { return m_bEnabled; }
+
+    void AddFrame_S16NE(int16_t left, int16_t right) { if (m_bEnabled) m_singleFrameAudio.AddFrame(left, right); }
 
     void AddFrames_S16NE(const uint8_t* data, unsigned int size);
 
+    /*!
+     * \brief Size the buffer for single samples from the core's timing
+     */
+    void SetTiming(double sampleRate, double frameRate) { m_singleFrameAudio.SetTiming(sampleRate, frameRate); }
+
+    /*!
+     * \brief Send the single samples of the frame as one packet
+     */
+    void OnFrameEnd() { m_singleFrameAudio.Flush(); }
+
   private:
     CGameLibRetro*        m_addon;
     CSingleFrameAudio     m_singleFrameAudio;
+    bool                  m_bEnabled = true;
 
     kodi::addon::CInstanceGame::CStream m_stream;
   };
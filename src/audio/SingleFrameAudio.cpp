@@ -8,28 +8,52 @@
 #include "SingleFrameAudio.h"
 #include "AudioStream.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace LIBRETRO;
 
-#define FRAMES_PER_PACKET  100 // This can be calculated from CLibretroEnvironment::GetSystemInfo().timing.sample_rate
+#define DEFAULT_SAMPLE_RATE  48000.0 // Until the core's timing is known
+#define DEFAULT_FRAME_RATE   60.0
+#define BUFFERED_VIDEO_FRAMES  2 // Headroom for frames with more audio than average
+#define MIN_FRAMES_PER_PACKET  64 // For cores reporting a very high frame rate
 #define SAMPLES_PER_FRAME  2 // L + R
 #define SAMPLE_SIZE        sizeof(int16_t)
 
 CSingleFrameAudio::CSingleFrameAudio(CAudioStream* audioStream) :
   m_audioStream(audioStream)
 {
-  m_data.reserve(FRAMES_PER_PACKET * SAMPLES_PER_FRAME);
+  SetTiming(DEFAULT_SAMPLE_RATE, DEFAULT_FRAME_RATE);
 }
 
-void CSingleFrameAudio::AddFrame(int16_t left, int16_t right)
+void CSingleFrameAudio::SetTiming(double sampleRate, double frameRate)
 {
-  m_data.push_back(left);
-  m_data.push_back(right);
-
-  const unsigned int frameCount = static_cast<unsigned int>(m_data.size() / SAMPLES_PER_FRAME);
-  if (frameCount >= FRAMES_PER_PACKET)
-  {
-    m_audioStream->AddFrames_S16NE(reinterpret_cast<const uint8_t*>(m_data.data()),
-        static_cast<unsigned int>(m_data.size() * SAMPLE_SIZE));
-    m_data.clear();
-  }
+  if (sampleRate <= 0.0)
+    sampleRate = DEFAULT_SAMPLE_RATE;
+
+  if (frameRate <= 0.0)
+    frameRate = DEFAULT_FRAME_RATE;
+
+  const unsigned int framesPerVideoFrame = static_cast<unsigned int>(std::ceil(sampleRate / frameRate));
+  const unsigned int capacity = std::max(framesPerVideoFrame * BUFFERED_VIDEO_FRAMES,
+      static_cast<unsigned int>(MIN_FRAMES_PER_PACKET));
+
+  if (capacity == m_capacity)
+    return;
+
+  Flush();
+
+  m_data.assign(capacity * SAMPLES_PER_FRAME, 0);
+  m_capacity = capacity;
+}
+
+void CSingleFrameAudio::Flush()
+{
+  if (m_frameCount == 0)
+    return;
+
+  m_audioStream->AddFrames_S16NE(reinterpret_cast<const uint8_t*>(m_data.data()),
+      static_cast<unsigned int>(m_frameCount * SAMPLES_PER_FRAME * SAMPLE_SIZE));
+
+  m_frameCount = 0;
 }
@@ -14,15 +14,51 @@ namespace LIBRETRO
 {
   class CAudioStream;
 
+  /*!
+   * \brief Batches audio from cores that report one sample at a time
+   *
+   * Samples are collected in a buffer that is allocated when the timing is
+   * known and holds a few frames of audio. It is sent as one packet at the
+   * end of each frame, or earlier if it fills up because the core produced
+   * more audio than its timing predicts.
+   */
   class CSingleFrameAudio
   {
   public:
     CSingleFrameAudio(CAudioStream* audioStream);
 
-    void AddFrame(int16_t left, int16_t right);
+    /*!
+     * \brief Size the buffer for the core's timing
+     *
+     * Samples that are still buffered are sent first.
+     */
+    void SetTiming(double sampleRate, double frameRate);
+
+    void AddFrame(int16_t left, int16_t right)
+    {
+      if (m_frameCount == m_capacity)
+        Flush();
+
+      int16_t* const frame = m_data.data() + m_frameCount * 2;
+      frame[0] = left;
+      frame[1] = right;
+      m_frameCount++;
+    }
+
+    /*!
+     * \brief Send the buffered samples as one packet
+     */
+    void Flush();
+
+    /*!
+     * \brief Discard the buffered samples
+     */
+    void Clear() { m_frameCount = 0; }
 
   private:
     CAudioStream* const  m_audioStream;
-    std::vector<int16_t> m_data;
+    std::vector<int16_t> m_data; // Interleaved L + R
+    unsigned int         m_capacity = 0; // In stereo frames
+    unsigned int         m_frameCount = 0;
   };
 }
@@ -0,0 +1,551 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "InstantReplay.h"
+#include "WavWriter.h"
+#include "Y4MWriter.h"
+#include "log/Log.h"
+#include "savestate/DeltaCodec.h"
+#include "utils/FrameProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define REPLAY_VIDEO_SLOTS  4 // Frames waiting to be compressed
+#define REPLAY_AUDIO_SLOTS  64 // Audio packets waiting to be stored
+#define REPLAY_POLL_MS      10 // Wake-ups from the emulation thread aren't synchronized, so the worker also polls
+#define AUDIO_FRAME_SIZE    4 // 16-bit stereo
+
+namespace
+{
+  size_t BytesPerPixel(GAME_PIXEL_FORMAT format)
+  {
+    return format == GAME_PIXEL_FORMAT_0RGB8888 ? 4 : 2;
+  }
+}
+
+CInstantReplay& CInstantReplay::Get()
+{
+  static CInstantReplay _instance;
+  return _instance;
+}
+
+void CInstantReplay::Initialize(unsigned int seconds, size_t maxBytes, double frameRate, double sampleRate, Y4M_COLOR color)
+{
+  Deinitialize();
+
+  if (seconds == 0 || maxBytes == 0)
+    return;
+
+  // Durations and clips are measured in frames and samples
+  if (frameRate <= 0.0 || sampleRate <= 0.0)
+  {
+    esyslog("Instant replay: core timing is unknown (%.3f fps, %.0f Hz), disabling replay", frameRate, sampleRate);
+    return;
+  }
+
+  m_seconds = seconds;
+  m_maxFrames = static_cast<unsigned int>(std::ceil(seconds * frameRate));
+  m_maxAudioFrames = static_cast<uint64_t>(std::ceil(seconds * sampleRate));
+  m_maxBytes = maxBytes;
+  m_keyframeInterval = std::max(1u, static_cast<unsigned int>(std::lround(frameRate)));
+  m_frameRateNum = static_cast<unsigned int>(std::lround(frameRate * 1000.0));
+  m_frameRateDen = 1000;
+  m_sampleRate = static_cast<unsigned int>(std::lround(sampleRate));
+  m_color = color;
+
+  m_videoQueue.reset(new CSpscQueue<VideoPacket>(REPLAY_VIDEO_SLOTS));
+  m_audioQueue.reset(new CSpscQueue<AudioPacket>(REPLAY_AUDIO_SLOTS));
+
+  m_videoFrames = 0;
+  m_audioPosition = 0;
+  m_droppedFrames = 0;
+  m_droppedAudioFrames = 0;
+
+  m_bHasReference = false;
+  m_framesSinceKeyframe = 0;
+
+  m_compressedFrames = 0;
+  m_rawBytes = 0;
+  m_compressedBytes = 0;
+  m_compressNs = 0;
+  m_clips = 0;
+
+  m_bStop = false;
+  m_worker = std::thread(&CInstantReplay::Process, this);
+
+  m_bEnabled = true;
+
+  isyslog("Instant replay: keeping %u seconds in up to %.1f MB", seconds, maxBytes / 1048576.0);
+}
+
+void CInstantReplay::SetTiming(double frameRate, double sampleRate)
+{
+  if (!m_bEnabled)
+    return;
+
+  const unsigned int frameRateNum = static_cast<unsigned int>(std::lround(frameRate * 1000.0));
+  const unsigned int rate = static_cast<unsigned int>(std::lround(sampleRate));
+  if (frameRateNum == m_frameRateNum && rate == m_sampleRate)
+    return;
+
+  // Clips can't change their rate, so the buffered seconds are dropped
+  isyslog("Instant replay: timing changed, clearing the buffer");
+
+  Initialize(m_seconds, m_maxBytes, frameRate, sampleRate, m_color);
+}
+
+void CInstantReplay::Deinitialize()
+{
+  if (!m_bEnabled)
+    return;
+
+  m_bEnabled = false;
+
+  // A clip being written is finished first
+  if (m_clipThread.joinable())
+    m_clipThread.join();
+
+  m_bStop = true;
+  m_wakeCondition.notify_one();
+  m_worker.join();
+
+  m_videoQueue.reset();
+  m_audioQueue.reset();
+
+  m_reference.clear();
+  m_reference.shrink_to_fit();
+  m_encoded.clear();
+  m_encoded.shrink_to_fit();
+
+  std::unique_lock<std::mutex> lock(m_bufferMutex);
+  m_video.clear();
+  m_audio.clear();
+  m_bufferedBytes = 0;
+}
+
+void CInstantReplay::AddVideoFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  if (!m_bEnabled)
+    return;
+
+  const uint64_t frameNumber = m_videoFrames++;
+
+  VideoPacket* packet = m_videoQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedFrames++;
+    return;
+  }
+
+  const size_t rowSize = width * BytesPerPixel(format);
+
+  packet->frameNumber = frameNumber;
+  packet->width = width;
+  packet->height = height;
+  packet->format = format;
+  packet->bDupe = false;
+
+  packet->data.resize(rowSize * height);
+  for (unsigned int y = 0; y < height; y++)
+    memcpy(packet->data.data() + y * rowSize, data + y * pitch, rowSize);
+
+  m_videoQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+void CInstantReplay::DupeVideoFrame()
+{
+  if (!m_bEnabled)
+    return;
+
+  const uint64_t frameNumber = m_videoFrames++;
+
+  VideoPacket* packet = m_videoQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedFrames++;
+    return;
+  }
+
+  packet->frameNumber = frameNumber;
+  packet->bDupe = true;
+
+  m_videoQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+void CInstantReplay::AddAudioFrames(const uint8_t* data, unsigned int size)
+{
+  if (!m_bEnabled)
+    return;
+
+  const uint64_t position = m_audioPosition;
+  m_audioPosition += size / AUDIO_FRAME_SIZE;
+
+  AudioPacket* packet = m_audioQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedAudioFrames += size / AUDIO_FRAME_SIZE;
+    return;
+  }
+
+  packet->position = position;
+  packet->frameNumber = m_videoFrames;
+  packet->data.assign(data, data + size);
+
+  m_audioQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+bool CInstantReplay::SaveClip(const std::string& basePath)
+{
+  if (!m_bEnabled)
+    return false;
+
+  if (m_bWritingClip)
+  {
+    esyslog("Instant replay: still writing the previous clip, rejecting \"%s\"", basePath.c_str());
+    return false;
+  }
+
+  if (m_clipThread.joinable())
+    m_clipThread.join();
+
+  // Copying the entries only copies references to the compressed data
+  Clip clip;
+  {
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    clip.video = m_video;
+    clip.audio = m_audio;
+  }
+
+  if (clip.video.empty() && clip.audio.empty())
+  {
+    esyslog("Instant replay: nothing to save yet");
+    return false;
+  }
+
+  m_bWritingClip = true;
+  m_clipThread = std::thread(&CInstantReplay::WriteClip, this, std::move(clip), basePath);
+
+  m_clips++;
+
+  return true;
+}
+
+void CInstantReplay::LogStatistics() const
+{
+  std::unique_lock<std::mutex> lock(m_bufferMutex);
+
+  if (m_compressedFrames == 0)
+    return;
+
+  isyslog("Instant replay: %llu frames compressed to %.1f%% in avg %.2f ms, %llu frames and %llu audio frames dropped",
+      static_cast<unsigned long long>(m_compressedFrames), 100.0 * m_compressedBytes / std::max(m_rawBytes, static_cast<uint64_t>(1)),
+      m_compressNs / 1000000.0 / m_compressedFrames, static_cast<unsigned long long>(m_droppedFrames),
+      static_cast<unsigned long long>(m_droppedAudioFrames));
+
+  const uint64_t bufferedFrames = m_video.empty() ? 0 : m_video.back().frameNumber - m_video.front().frameNumber + 1;
+
+  isyslog("Instant replay: %.1f s buffered in %.1f MB of %.1f MB, %llu clips saved",
+      bufferedFrames * static_cast<double>(m_frameRateDen) / m_frameRateNum, m_bufferedBytes / 1048576.0,
+      m_maxBytes / 1048576.0, static_cast<unsigned long long>(m_clips));
+}
+
+void CInstantReplay::Process()
+{
+  while (!m_bStop)
+  {
+    bool bWorked = false;
+
+    while (VideoPacket* packet = m_videoQueue->Front())
+    {
+      CompressFrame(*packet);
+      m_videoQueue->Pop();
+      bWorked = true;
+    }
+
+    while (AudioPacket* packet = m_audioQueue->Front())
+    {
+      StoreAudio(*packet);
+      m_audioQueue->Pop();
+      bWorked = true;
+    }
+
+    if (!bWorked)
+    {
+      std::unique_lock<std::mutex> lock(m_wakeMutex);
+      m_wakeCondition.wait_for(lock, std::chrono::milliseconds(REPLAY_POLL_MS));
+    }
+  }
+}
+
+void CInstantReplay::CompressFrame(const VideoPacket& packet)
+{
+  // Nothing to repeat yet
+  if (packet.bDupe && !m_bHasReference)
+    return;
+
+  // Eviction may have emptied the buffer, which must start with a keyframe
+  bool bStartGroup;
+  {
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    bStartGroup = m_video.empty() || !m_video.front().bKeyframe;
+  }
+
+  VideoEntry entry{};
+  entry.frameNumber = packet.frameNumber;
+
+  if (packet.bDupe && !bStartGroup)
+  {
+    entry.width = m_referenceWidth;
+    entry.height = m_referenceHeight;
+    entry.format = m_referenceFormat;
+
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    m_video.emplace_back(std::move(entry));
+    m_bufferedBytes += EntrySize(m_video.back());
+    Evict();
+
+    return;
+  }
+
+  const int64_t startNs = CFrameProfiler::Now();
+
+  if (packet.bDupe)
+  {
+    // The repeated frame starts the new group
+    CDeltaCodec::Encode(m_reference.data(), nullptr, m_reference.size(), m_encoded);
+    m_framesSinceKeyframe = 1;
+
+    entry.bKeyframe = true;
+  }
+  else
+  {
+    const bool bKeyframe = bStartGroup || !m_bHasReference || m_framesSinceKeyframe >= m_keyframeInterval ||
+        packet.width != m_referenceWidth || packet.height != m_referenceHeight || packet.format != m_referenceFormat;
+
+    CDeltaCodec::Encode(packet.data.data(), bKeyframe ? nullptr : m_reference.data(), packet.data.size(), m_encoded);
+
+    m_reference.assign(packet.data.begin(), packet.data.end());
+    m_referenceWidth = packet.width;
+    m_referenceHeight = packet.height;
+    m_referenceFormat = packet.format;
+    m_bHasReference = true;
+    m_framesSinceKeyframe = bKeyframe ? 1 : m_framesSinceKeyframe + 1;
+
+    entry.bKeyframe = bKeyframe;
+  }
+
+  entry.width = m_referenceWidth;
+  entry.height = m_referenceHeight;
+  entry.format = m_referenceFormat;
+  entry.delta = std::make_shared<std::vector<uint8_t>>(m_encoded.begin(), m_encoded.end());
+
+  const uint64_t elapsedNs = static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+
+  std::unique_lock<std::mutex> lock(m_bufferMutex);
+
+  m_video.emplace_back(std::move(entry));
+  m_bufferedBytes += EntrySize(m_video.back());
+  Evict();
+
+  m_compressedFrames++;
+  m_rawBytes += m_reference.size();
+  m_compressedBytes += m_encoded.size();
+  m_compressNs += elapsedNs;
+}
+
+void CInstantReplay::StoreAudio(const AudioPacket& packet)
+{
+  AudioEntry entry;
+  entry.position = packet.position;
+  entry.frameNumber = packet.frameNumber;
+  entry.data = std::make_shared<std::vector<uint8_t>>(packet.data);
+
+  std::unique_lock<std::mutex> lock(m_bufferMutex);
+
+  m_audio.emplace_back(std::move(entry));
+  m_bufferedBytes += EntrySize(m_audio.back());
+  Evict();
+}
+
+void CInstantReplay::Evict()
+{
+  // Drop the oldest keyframe along with the frames that depend on it
+  auto EvictGroup = [this]()
+  {
+    do
+    {
+      m_bufferedBytes -= EntrySize(m_video.front());
+      m_video.pop_front();
+    } while (!m_video.empty() && !m_video.front().bKeyframe);
+  };
+
+  auto HasNewerGroup = [this]()
+  {
+    return !m_video.empty() &&
+        std::any_of(m_video.begin() + 1, m_video.end(), [](const VideoEntry& entry) { return entry.bKeyframe; });
+  };
+
+  while (!m_video.empty() && m_video.back().frameNumber - m_video.front().frameNumber >= m_maxFrames)
+    EvictGroup();
+
+  // Over the memory limit, the oldest data goes first. The current group is
+  // only evicted if it doesn't fit on its own, and the next frame then
+  // starts a new group. If fewer than two groups fit, keyframes are made
+  // more frequent, so that the buffer doesn't shrink to a single group.
+  while (m_bufferedBytes > m_maxBytes)
+  {
+    const bool bVideoIsOlder = !m_video.empty() &&
+        (m_audio.empty() || m_video.front().frameNumber <= m_audio.front().frameNumber);
+
+    if (bVideoIsOlder && HasNewerGroup())
+    {
+      EvictGroup();
+    }
+    else if (!m_audio.empty())
+    {
+      m_bufferedBytes -= EntrySize(m_audio.front());
+      m_audio.pop_front();
+      continue;
+    }
+    else if (!m_video.empty())
+    {
+      EvictGroup();
+    }
+    else
+    {
+      break;
+    }
+
+    if (!HasNewerGroup() && m_keyframeInterval > 1)
+    {
+      m_keyframeInterval = std::max(1u, m_keyframeInterval / 2);
+      dsyslog("Instant replay: reducing the keyframe interval to %u frames to fit the memory limit", m_keyframeInterval);
+    }
+  }
+
+  // Audio goes with the video, or is limited on its own for cores without
+  // video
+  while (!m_audio.empty())
+  {
+    const AudioEntry& oldest = m_audio.front();
+
+    const bool bOlderThanVideo = !m_video.empty() && oldest.frameNumber < m_video.front().frameNumber;
+    const bool bOverDuration = m_audio.back().position - oldest.position >= m_maxAudioFrames;
+
+    if (!bOlderThanVideo && !bOverDuration)
+      break;
+
+    m_bufferedBytes -= EntrySize(oldest);
+    m_audio.pop_front();
+  }
+}
+
+size_t CInstantReplay::EntrySize(const VideoEntry& entry)
+{
+  return sizeof(entry) + (entry.delta ? entry.delta->size() : 0);
+}
+
+size_t CInstantReplay::EntrySize(const AudioEntry& entry)
+{
+  return sizeof(entry) + entry.data->size();
+}
+
+void CInstantReplay::WriteClip(Clip clip, std::string basePath)
+{
+  const int64_t startNs = CFrameProfiler::Now();
+
+  CY4MWriter videoFile;
+  std::vector<uint8_t> frame;
+  unsigned int segment = 0;
+  uint64_t nextFrame = clip.video.empty() ? 0 : clip.video.front().frameNumber;
+
+  for (const VideoEntry& entry : clip.video)
+  {
+    // Frames dropped from the queue are replaced by the previous frame
+    for (; nextFrame < entry.frameNumber; nextFrame++)
+      videoFile.RepeatFrame();
+
+    nextFrame = entry.frameNumber + 1;
+
+    if (!entry.delta)
+    {
+      videoFile.RepeatFrame();
+      continue;
+    }
+
+    const size_t rowSize = entry.width * BytesPerPixel(entry.format);
+    const size_t size = rowSize * entry.height;
+
+    if (entry.bKeyframe)
+    {
+      frame.assign(size, 0);
+
+      // Y4M can't change resolution, so a new file is started
+      if (entry.width != videoFile.Width() || entry.height != videoFile.Height() || segment == 0)
+      {
+        std::string path = basePath;
+        if (++segment > 1)
+          path += "-" + std::to_string(segment);
+        path += ".y4m";
+
+        videoFile.Open(path, entry.width, entry.height, m_frameRateNum, m_frameRateDen, m_color);
+      }
+    }
+
+    if (frame.size() != size || !CDeltaCodec::Apply(entry.delta->data(), entry.delta->size(), frame.data(), size))
+    {
+      esyslog("Instant replay: frame %llu is corrupt, stopping the clip", static_cast<unsigned long long>(entry.frameNumber));
+      break;
+    }
+
+    videoFile.WriteFrame(frame.data(), rowSize, entry.format);
+  }
+
+  videoFile.Close();
+
+  if (!clip.audio.empty())
+  {
+    CWavWriter audioFile;
+    if (audioFile.Open(basePath + ".wav", m_sampleRate))
+    {
+      uint64_t position = clip.audio.front().position;
+
+      // Audio evicted to stay under the memory limit is replaced by silence,
+      // so that the clip starts in sync
+      if (!clip.video.empty() && clip.audio.front().frameNumber > clip.video.front().frameNumber)
+      {
+        const uint64_t frames = clip.audio.front().frameNumber - clip.video.front().frameNumber;
+        audioFile.WriteSilence(frames * m_sampleRate * m_frameRateDen / m_frameRateNum);
+      }
+
+      for (const AudioEntry& entry : clip.audio)
+      {
+        // Audio dropped from the queue is replaced by silence
+        if (entry.position > position)
+          audioFile.WriteSilence(entry.position - position);
+
+        audioFile.Write(entry.data->data(), entry.data->size());
+        position = entry.position + entry.data->size() / AUDIO_FRAME_SIZE;
+      }
+    }
+  }
+
+  const uint64_t frames = clip.video.empty() ? 0 : clip.video.back().frameNumber - clip.video.front().frameNumber + 1;
+
+  isyslog("Instant replay: saved %llu frames to \"%s\" in %.0f ms", static_cast<unsigned long long>(frames),
+      basePath.c_str(), (CFrameProfiler::Now() - startNs) / 1000000.0);
+
+  m_bWritingClip = false;
+}
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Y4MWriter.h"
+#include "utils/SpscQueue.h"
+
+#include <kodi/addon-instance/Game.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Keeps the last seconds of video and audio in memory, so that
+   *        they can be saved as a clip after the fact
+   *
+   * Frames are copied into a lock-free queue on the emulation thread. A
+   * worker thread compresses them with CDeltaCodec: every second a
+   * keyframe against zeros, and the XOR against the previous frame in
+   * between, which is mostly zero for game video. Audio is kept as is.
+   *
+   * The buffer never holds more than the given duration or memory. The
+   * oldest keyframe is dropped together with the frames after it, because
+   * they can't be decoded without it. If fewer than two seconds of video fit
+   * the memory limit, keyframes are made more frequent.
+   *
+   * Saving decodes a snapshot of the buffer to Y4M and WAV files on another
+   * thread. The snapshot shares the compressed data with the buffer, so
+   * data evicted while the clip is written is only freed afterwards.
+   */
+  class CInstantReplay
+  {
+  private:
+    CInstantReplay() = default;
+
+  public:
+    static CInstantReplay& Get();
+
+    /*!
+     * \brief Start buffering
+     *
+     * \param seconds The duration to keep
+     * \param maxBytes The memory limit of the compressed data
+     * \param frameRate The core's frame rate
+     * \param sampleRate The core's audio sample rate
+     * \param color How the video frames of saved clips are stored
+     */
+    void Initialize(unsigned int seconds, size_t maxBytes, double frameRate, double sampleRate, Y4M_COLOR color);
+
+    /*!
+     * \brief Called when the core changes its timing, which clears the buffer
+     */
+    void SetTiming(double frameRate, double sampleRate);
+    void Deinitialize();
+
+    bool IsEnabled() const { return m_bEnabled; }
+
+    void AddVideoFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format);
+    void DupeVideoFrame();
+    void AddAudioFrames(const uint8_t* data, unsigned int size);
+
+    /*!
+     * \brief Write the buffered video and audio to <basePath>.y4m and
+     *        <basePath>.wav in the background
+     *
+     * \return False if replay is disabled, nothing is buffered or a clip
+     *         is still being written
+     */
+    bool SaveClip(const std::string& basePath);
+
+    void LogStatistics() const;
+
+  private:
+    using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct VideoPacket
+    {
+      uint64_t frameNumber = 0;
+      unsigned int width = 0;
+      unsigned int height = 0;
+      GAME_PIXEL_FORMAT format = GAME_PIXEL_FORMAT_UNKNOWN;
+      bool bDupe = false;
+      std::vector<uint8_t> data; // Rows without padding
+    };
+
+    struct AudioPacket
+    {
+      uint64_t position = 0; // In stereo frames since the start
+      uint64_t frameNumber = 0; // Video frame the audio belongs to
+      std::vector<uint8_t> data;
+    };
+
+    struct VideoEntry
+    {
+      uint64_t frameNumber;
+      unsigned int width;
+      unsigned int height;
+      GAME_PIXEL_FORMAT format;
+      bool bKeyframe;
+      Buffer delta; // Empty for repeated frames
+    };
+
+    struct AudioEntry
+    {
+      uint64_t position;
+      uint64_t frameNumber;
+      Buffer data;
+    };
+
+    struct Clip
+    {
+      std::deque<VideoEntry> video;
+      std::deque<AudioEntry> audio;
+    };
+
+    // Worker thread functions
+    void Process();
+    void CompressFrame(const VideoPacket& packet);
+    void StoreAudio(const AudioPacket& packet);
+    void Evict();
+    static size_t EntrySize(const VideoEntry& entry);
+    static size_t EntrySize(const AudioEntry& entry);
+
+    // Clip thread function
+    void WriteClip(Clip clip, std::string basePath);
+
+    // Settings
+    unsigned int m_seconds = 0;
+    unsigned int m_maxFrames = 0;
+    uint64_t m_maxAudioFrames = 0;
+    size_t m_maxBytes = 0;
+    unsigned int m_keyframeInterval = 0;
+    unsigned int m_frameRateNum = 0;
+    unsigned int m_frameRateDen = 1;
+    Y4M_COLOR m_color = Y4M_COLOR_GBR;
+    unsigned int m_sampleRate = 0;
+    bool m_bEnabled = false;
+
+    // Emulation thread
+    uint64_t m_videoFrames = 0;
+    uint64_t m_audioPosition = 0;
+    uint64_t m_droppedFrames = 0;
+    uint64_t m_droppedAudioFrames = 0;
+
+    // Queues
+    std::unique_ptr<CSpscQueue<VideoPacket>> m_videoQueue;
+    std::unique_ptr<CSpscQueue<AudioPacket>> m_audioQueue;
+
+    // Worker thread
+    std::thread m_worker;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<bool> m_bStop{false};
+    std::vector<uint8_t> m_reference; // Last frame, decoded
+    unsigned int m_referenceWidth = 0;
+    unsigned int m_referenceHeight = 0;
+    GAME_PIXEL_FORMAT m_referenceFormat = GAME_PIXEL_FORMAT_UNKNOWN;
+    bool m_bHasReference = false;
+    std::vector<uint8_t> m_encoded;
+    unsigned int m_framesSinceKeyframe = 0;
+
+    // Buffer, shared with SaveClip()
+    mutable std::mutex m_bufferMutex;
+    std::deque<VideoEntry> m_video;
+    std::deque<AudioEntry> m_audio;
+    size_t m_bufferedBytes = 0;
+
+    // Clip writer
+    std::thread m_clipThread;
+    std::atomic<bool> m_bWritingClip{false};
+
+    // Statistics, written by the worker with the buffer locked
+    uint64_t m_compressedFrames = 0;
+    uint64_t m_rawBytes = 0;
+    uint64_t m_compressedBytes = 0;
+    uint64_t m_compressNs = 0;
+    uint64_t m_clips = 0; // Emulation thread
+  };
+}
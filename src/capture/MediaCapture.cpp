@@ -0,0 +1,326 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "MediaCapture.h"
+#include "log/Log.h"
+#include "utils/FrameProfiler.h"
+
+#include <chrono>
+#include <cmath>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define CAPTURE_VIDEO_SLOTS    16 // Frames that can wait for the disk
+#define CAPTURE_AUDIO_SLOTS    256 // Audio packets that can wait for the disk
+#define CAPTURE_POLL_MS        10 // Wake-ups from the emulation thread aren't synchronized, so the writer also polls
+#define AUDIO_FRAME_SIZE       4 // 16-bit stereo
+
+CMediaCapture& CMediaCapture::Get()
+{
+  static CMediaCapture _instance;
+  return _instance;
+}
+
+bool CMediaCapture::Start(const std::string& basePath, double frameRate, double sampleRate, Y4M_COLOR color)
+{
+  Stop();
+
+  m_sessionPath = basePath;
+  m_sessionPart = 1;
+  m_color = color;
+
+  return Open(basePath, frameRate, sampleRate);
+}
+
+void CMediaCapture::SetTiming(double frameRate, double sampleRate)
+{
+  if (!m_bActive)
+    return;
+
+  const unsigned int frameRateNum = static_cast<unsigned int>(std::lround(frameRate * 1000.0));
+  const unsigned int rate = static_cast<unsigned int>(std::lround(sampleRate));
+  if (frameRateNum == m_frameRateNum && rate == m_sampleRate)
+    return;
+
+  // Y4M and WAV give their rate in the header, so the files are finished and
+  // the capture continues in a new pair
+  Stop();
+  LogStatistics();
+
+  isyslog("Capture: timing changed, starting part %u", m_sessionPart + 1);
+
+  Open(m_sessionPath + "-part" + std::to_string(++m_sessionPart), frameRate, sampleRate);
+}
+
+bool CMediaCapture::Open(const std::string& basePath, double frameRate, double sampleRate)
+{
+  m_videoFrames = 0;
+  m_audioPosition = 0;
+  m_droppedVideoFrames = 0;
+  m_droppedAudioFrames = 0;
+
+  m_videoSegment = 0;
+  m_videoWidth = 0;
+  m_videoHeight = 0;
+  m_writtenFrames = 0;
+  m_writtenAudioFrames = 0;
+
+  m_writtenBytes = 0;
+  m_writeNs = 0;
+
+  // Files with a made-up rate would play at the wrong speed
+  if (frameRate <= 0.0 || sampleRate <= 0.0)
+  {
+    esyslog("Capture: core timing is unknown (%.3f fps, %.0f Hz), not recording", frameRate, sampleRate);
+    return false;
+  }
+
+  m_basePath = basePath;
+  m_frameRateNum = static_cast<unsigned int>(std::lround(frameRate * 1000.0));
+  m_frameRateDen = 1000;
+  m_sampleRate = static_cast<unsigned int>(std::lround(sampleRate));
+
+  if (!m_audioFile.Open(m_basePath + ".wav", m_sampleRate))
+    return false;
+
+  m_videoQueue.reset(new CSpscQueue<VideoPacket>(CAPTURE_VIDEO_SLOTS));
+  m_audioQueue.reset(new CSpscQueue<AudioPacket>(CAPTURE_AUDIO_SLOTS));
+
+  m_bStop = false;
+  m_writer = std::thread(&CMediaCapture::Process, this);
+
+  m_bActive = true;
+
+  isyslog("Capture: recording to \"%s\" (%.3f fps, %u Hz)", m_basePath.c_str(), frameRate, m_sampleRate);
+
+  return true;
+}
+
+void CMediaCapture::Stop()
+{
+  if (!m_bActive)
+    return;
+
+  m_bActive = false;
+
+  // The writer drains the queues before exiting
+  m_bStop = true;
+  m_wakeCondition.notify_one();
+  m_writer.join();
+
+  m_writtenBytes += m_videoFile.WrittenBytes() + m_audioFile.WrittenBytes();
+  m_videoFile.Close();
+  m_audioFile.Close();
+
+  m_videoQueue.reset();
+  m_audioQueue.reset();
+}
+
+void CMediaCapture::AddVideoFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  if (!m_bActive)
+    return;
+
+  const uint64_t frameNumber = m_videoFrames++;
+
+  VideoPacket* packet = m_videoQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedVideoFrames++;
+    return;
+  }
+
+  const size_t rowSize = static_cast<size_t>(width) * (format == GAME_PIXEL_FORMAT_0RGB8888 ? 4 : 2);
+
+  packet->frameNumber = frameNumber;
+  packet->width = width;
+  packet->height = height;
+  packet->format = format;
+  packet->bDupe = false;
+
+  // Slots keep their buffers, so this only allocates for larger frames
+  packet->data.resize(rowSize * height);
+  for (unsigned int y = 0; y < height; y++)
+    memcpy(packet->data.data() + y * rowSize, data + y * pitch, rowSize);
+
+  m_videoQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+void CMediaCapture::DupeVideoFrame()
+{
+  if (!m_bActive)
+    return;
+
+  const uint64_t frameNumber = m_videoFrames++;
+
+  VideoPacket* packet = m_videoQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedVideoFrames++;
+    return;
+  }
+
+  packet->frameNumber = frameNumber;
+  packet->bDupe = true;
+
+  m_videoQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+void CMediaCapture::AddAudioFrames(const uint8_t* data, unsigned int size)
+{
+  if (!m_bActive)
+    return;
+
+  const uint64_t position = m_audioPosition;
+  m_audioPosition += size / AUDIO_FRAME_SIZE;
+
+  AudioPacket* packet = m_audioQueue->BeginPush();
+  if (packet == nullptr)
+  {
+    m_droppedAudioFrames += size / AUDIO_FRAME_SIZE;
+    return;
+  }
+
+  packet->position = position;
+  packet->data.assign(data, data + size);
+
+  m_audioQueue->EndPush();
+  m_wakeCondition.notify_one();
+}
+
+void CMediaCapture::LogStatistics() const
+{
+  if (m_videoFrames == 0 && m_audioPosition == 0)
+    return;
+
+  isyslog("Capture: %llu video frames, %llu dropped and replaced by repeats",
+      static_cast<unsigned long long>(m_videoFrames), static_cast<unsigned long long>(m_droppedVideoFrames));
+  isyslog("Capture: %llu audio frames, %llu dropped and replaced by silence",
+      static_cast<unsigned long long>(m_audioPosition), static_cast<unsigned long long>(m_droppedAudioFrames));
+
+  if (m_writeNs > 0)
+  {
+    isyslog("Capture: %.1f MB written at %.1f MB/s", m_writtenBytes / 1048576.0,
+        m_writtenBytes / 1048576.0 / (m_writeNs / 1000000000.0));
+  }
+}
+
+void CMediaCapture::Process()
+{
+  while (true)
+  {
+    // Packets pushed before the stop request are still written
+    const bool bStop = m_bStop;
+    bool bWorked = false;
+
+    while (VideoPacket* packet = m_videoQueue->Front())
+    {
+      WriteVideo(*packet);
+      m_videoQueue->Pop();
+      bWorked = true;
+    }
+
+    while (AudioPacket* packet = m_audioQueue->Front())
+    {
+      WriteAudio(*packet);
+      m_audioQueue->Pop();
+      bWorked = true;
+    }
+
+    if (bStop)
+    {
+      // Packets dropped at the end are filled in too. The counters are
+      // final once the stop request is seen.
+      RepeatFrames(m_videoFrames);
+      WriteSilence(m_audioPosition);
+      break;
+    }
+
+    if (!bWorked)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeCondition.wait_for(lock, std::chrono::milliseconds(CAPTURE_POLL_MS));
+    }
+  }
+}
+
+void CMediaCapture::WriteVideo(const VideoPacket& packet)
+{
+  const int64_t startNs = CFrameProfiler::Now();
+
+  RepeatFrames(packet.frameNumber);
+
+  if (packet.bDupe)
+  {
+    m_videoFile.RepeatFrame();
+  }
+  else
+  {
+    if (packet.width != m_videoWidth || packet.height != m_videoHeight)
+      OpenVideoFile(packet.width, packet.height);
+
+    const size_t pitch = static_cast<size_t>(packet.width) * (packet.format == GAME_PIXEL_FORMAT_0RGB8888 ? 4 : 2);
+    m_videoFile.WriteFrame(packet.data.data(), pitch, packet.format);
+  }
+
+  m_writtenFrames = packet.frameNumber + 1;
+
+  m_writeNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+}
+
+void CMediaCapture::WriteAudio(const AudioPacket& packet)
+{
+  const int64_t startNs = CFrameProfiler::Now();
+
+  WriteSilence(packet.position);
+
+  m_audioFile.Write(packet.data.data(), packet.data.size());
+
+  m_writtenAudioFrames = packet.position + packet.data.size() / AUDIO_FRAME_SIZE;
+
+  m_writeNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+}
+
+void CMediaCapture::RepeatFrames(uint64_t frameNumber)
+{
+  // Frames dropped from the queue are replaced by the previous frame
+  if (!m_videoFile.HasFrame())
+    return;
+
+  for (; m_writtenFrames < frameNumber; m_writtenFrames++)
+    m_videoFile.RepeatFrame();
+}
+
+void CMediaCapture::WriteSilence(uint64_t position)
+{
+  // Audio dropped from the queue is replaced by silence
+  if (position > m_writtenAudioFrames)
+  {
+    m_audioFile.WriteSilence(position - m_writtenAudioFrames);
+    m_writtenAudioFrames = position;
+  }
+}
+
+void CMediaCapture::OpenVideoFile(unsigned int width, unsigned int height)
+{
+  // The file of the previous segment, not of a previous part
+  if (m_videoSegment > 0)
+    m_writtenBytes += m_videoFile.WrittenBytes();
+
+  m_videoWidth = width;
+  m_videoHeight = height;
+
+  std::string path = m_basePath;
+  if (++m_videoSegment > 1)
+    path += "-" + std::to_string(m_videoSegment);
+  path += ".y4m";
+
+  m_videoFile.Open(path, width, height, m_frameRateNum, m_frameRateDen, m_color);
+}
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "WavWriter.h"
+#include "Y4MWriter.h"
+#include "utils/SpscQueue.h"
+
+#include <kodi/addon-instance/Game.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Streams the video and audio of a session to uncompressed files
+   *
+   * Frames and audio packets are copied into lock-free queues on the
+   * emulation thread, which never waits for the disk. A writer thread
+   * drains the queues into a Y4M file and a WAV file.
+   *
+   * The queues have a fixed number of slots. If the disk can't keep up, new
+   * packets are dropped and counted. Dropped frames are replaced by repeats
+   * of the previous frame and dropped audio by silence, so the two files
+   * stay in sync.
+   *
+   * Y4M can't change resolution, so a geometry change starts a new video
+   * file, numbered from 2.
+   */
+  class CMediaCapture
+  {
+  private:
+    CMediaCapture() = default;
+
+  public:
+    static CMediaCapture& Get();
+
+    /*!
+     * \brief Start capturing to <basePath>.y4m and <basePath>.wav
+     *
+     * \param frameRate The core's frame rate
+     * \param sampleRate The core's audio sample rate
+     * \param color How the video frames are stored
+     */
+    bool Start(const std::string& basePath, double frameRate, double sampleRate, Y4M_COLOR color);
+
+    /*!
+     * \brief Called when the core changes its timing
+     *
+     * The files written so far are closed, and the capture continues in
+     * <basePath>-part2.y4m and <basePath>-part2.wav, and so on.
+     */
+    void SetTiming(double frameRate, double sampleRate);
+
+    /*!
+     * \brief Write the remaining packets and close the files
+     */
+    void Stop();
+
+    bool IsActive() const { return m_bActive; }
+
+    /*!
+     * \brief Queue a copy of a video frame
+     */
+    void AddVideoFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief Repeat the previous video frame
+     */
+    void DupeVideoFrame();
+
+    /*!
+     * \brief Queue a copy of interleaved 16-bit stereo samples
+     */
+    void AddAudioFrames(const uint8_t* data, unsigned int size);
+
+    void LogStatistics() const;
+
+  private:
+    struct VideoPacket
+    {
+      uint64_t frameNumber = 0;
+      unsigned int width = 0;
+      unsigned int height = 0;
+      GAME_PIXEL_FORMAT format = GAME_PIXEL_FORMAT_UNKNOWN;
+      bool bDupe = false;
+      std::vector<uint8_t> data; // Rows without padding
+    };
+
+    struct AudioPacket
+    {
+      uint64_t position = 0; // In stereo frames since the start
+      std::vector<uint8_t> data;
+    };
+
+    bool Open(const std::string& basePath, double frameRate, double sampleRate);
+
+    // Writer thread functions
+    void Process();
+    void WriteVideo(const VideoPacket& packet);
+    void WriteAudio(const AudioPacket& packet);
+    void RepeatFrames(uint64_t frameNumber);
+    void WriteSilence(uint64_t position);
+    void OpenVideoFile(unsigned int width, unsigned int height);
+
+    // Session
+    std::string m_sessionPath;
+    unsigned int m_sessionPart = 0;
+    std::string m_basePath; // Of the current part
+    unsigned int m_frameRateNum = 0;
+    unsigned int m_frameRateDen = 1;
+    Y4M_COLOR m_color = Y4M_COLOR_GBR;
+    unsigned int m_sampleRate = 0;
+    bool m_bActive = false;
+
+    // Emulation thread
+    uint64_t m_videoFrames = 0;
+    uint64_t m_audioPosition = 0;
+    uint64_t m_droppedVideoFrames = 0;
+    uint64_t m_droppedAudioFrames = 0;
+
+    // Queues
+    std::unique_ptr<CSpscQueue<VideoPacket>> m_videoQueue;
+    std::unique_ptr<CSpscQueue<AudioPacket>> m_audioQueue;
+
+    // Writer thread
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<bool> m_bStop{false};
+
+    // Video file
+    CY4MWriter m_videoFile;
+    unsigned int m_videoSegment = 0;
+    unsigned int m_videoWidth = 0;
+    unsigned int m_videoHeight = 0;
+    uint64_t m_writtenFrames = 0; // Including repeats, in frame numbers
+
+    // Audio file
+    CWavWriter m_audioFile;
+    uint64_t m_writtenAudioFrames = 0; // Including silence
+
+    // Statistics, owned by the writer until it has been joined
+    uint64_t m_writtenBytes = 0; // Of closed files
+    uint64_t m_writeNs = 0;
+  };
+}
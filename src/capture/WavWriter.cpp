@@ -0,0 +1,141 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "WavWriter.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define AUDIO_FRAME_SIZE    4 // 16-bit stereo
+#define WAV_HEADER_SIZE     44
+#define SILENCE_CHUNK_SIZE  4096
+
+namespace
+{
+  void WriteU16(uint8_t* buffer, uint16_t value)
+  {
+    buffer[0] = static_cast<uint8_t>(value);
+    buffer[1] = static_cast<uint8_t>(value >> 8);
+  }
+
+  void WriteU32(uint8_t* buffer, uint32_t value)
+  {
+    for (unsigned int i = 0; i < 4; i++)
+      buffer[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+
+  void BuildHeader(uint8_t* header, unsigned int sampleRate, uint32_t dataSize)
+  {
+    memcpy(header, "RIFF", 4);
+    WriteU32(header + 4, dataSize + WAV_HEADER_SIZE - 8);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    WriteU32(header + 16, 16); // Size of the format chunk
+    WriteU16(header + 20, 1); // PCM
+    WriteU16(header + 22, 2); // Channels
+    WriteU32(header + 24, sampleRate);
+    WriteU32(header + 28, sampleRate * AUDIO_FRAME_SIZE);
+    WriteU16(header + 32, AUDIO_FRAME_SIZE);
+    WriteU16(header + 34, 16); // Bits per sample
+    memcpy(header + 36, "data", 4);
+    WriteU32(header + 40, dataSize);
+  }
+}
+
+bool CWavWriter::Open(const std::string& path, unsigned int sampleRate)
+{
+  Close();
+
+  m_writtenBytes = 0;
+
+  if (!m_file.OpenFileForWrite(path, true))
+  {
+    esyslog("WAV: failed to open \"%s\" for writing", path.c_str());
+    return false;
+  }
+
+  m_bOpen = true;
+  m_sampleRate = sampleRate;
+  m_frames = 0;
+
+  uint8_t header[WAV_HEADER_SIZE];
+  BuildHeader(header, m_sampleRate, 0);
+
+  return WriteData(header, sizeof(header));
+}
+
+void CWavWriter::Close()
+{
+  if (!m_bOpen)
+    return;
+
+  const uint64_t dataSize = std::min(m_frames * AUDIO_FRAME_SIZE, static_cast<uint64_t>(UINT32_MAX - WAV_HEADER_SIZE));
+
+  uint8_t header[WAV_HEADER_SIZE];
+  BuildHeader(header, m_sampleRate, static_cast<uint32_t>(dataSize));
+
+  if (m_file.Seek(0, SEEK_SET) != 0 || m_file.Write(header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)))
+    esyslog("WAV: failed to update the header");
+
+  m_file.Close();
+  m_bOpen = false;
+
+  m_silence.clear();
+  m_silence.shrink_to_fit();
+}
+
+bool CWavWriter::Write(const uint8_t* data, size_t size)
+{
+  if (!m_bOpen)
+    return false;
+
+  if (!WriteData(data, size))
+    return false;
+
+  m_frames += size / AUDIO_FRAME_SIZE;
+
+  return true;
+}
+
+bool CWavWriter::WriteSilence(uint64_t frames)
+{
+  if (!m_bOpen)
+    return false;
+
+  m_silence.resize(SILENCE_CHUNK_SIZE);
+
+  uint64_t remaining = frames * AUDIO_FRAME_SIZE;
+  while (remaining > 0)
+  {
+    const size_t chunk = static_cast<size_t>(std::min(remaining, static_cast<uint64_t>(SILENCE_CHUNK_SIZE)));
+    if (!WriteData(m_silence.data(), chunk))
+      return false;
+    remaining -= chunk;
+  }
+
+  m_frames += frames;
+
+  return true;
+}
+
+bool CWavWriter::WriteData(const void* data, size_t size)
+{
+  if (m_file.Write(data, size) != static_cast<ssize_t>(size))
+  {
+    esyslog("WAV: failed to write, closing file");
+    m_file.Close();
+    m_bOpen = false;
+    return false;
+  }
+
+  m_writtenBytes += size;
+
+  return true;
+}
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/Filesystem.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Writes 16-bit stereo audio to a WAV file
+   *
+   * The sizes in the header are filled in when the file is closed.
+   */
+  class CWavWriter
+  {
+  public:
+    CWavWriter() = default;
+    ~CWavWriter() { Close(); }
+
+    bool Open(const std::string& path, unsigned int sampleRate);
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+
+    /*!
+     * \brief Write interleaved native endian samples
+     *
+     * \return False if writing failed, the file is unusable afterwards
+     */
+    bool Write(const uint8_t* data, size_t size);
+
+    /*!
+     * \brief Write silence for the given number of stereo frames
+     */
+    bool WriteSilence(uint64_t frames);
+
+    /*!
+     * \brief Number of stereo frames written
+     */
+    uint64_t Frames() const { return m_frames; }
+
+    /*!
+     * \brief Bytes written to the current or last file
+     */
+    uint64_t WrittenBytes() const { return m_writtenBytes; }
+
+  private:
+    bool WriteData(const void* data, size_t size);
+
+    kodi::vfs::CFile m_file;
+    bool m_bOpen = false;
+    unsigned int m_sampleRate = 0;
+    uint64_t m_frames = 0;
+    std::vector<uint8_t> m_silence;
+
+    uint64_t m_writtenBytes = 0;
+  };
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Y4MWriter.h"
+#include "log/Log.h"
+
+#include <stdio.h>
+
+using namespace LIBRETRO;
+
+bool CY4MWriter::Open(const std::string& path, unsigned int width, unsigned int height, unsigned int frameRateNum, unsigned int frameRateDen, Y4M_COLOR color)
+{
+  Close();
+
+  m_writtenBytes = 0;
+
+  if (!m_file.OpenFileForWrite(path, true))
+  {
+    esyslog("Y4M: failed to open \"%s\" for writing", path.c_str());
+    return false;
+  }
+
+  m_bOpen = true;
+  m_width = width;
+  m_height = height;
+  m_color = color;
+  m_bHasFrame = false;
+
+  m_converter.SelectKernel();
+
+  char header[128];
+  const int length = snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:%u Ip A0:0 C444 XCOLORRANGE=FULL%s\n",
+      width, height, frameRateNum, frameRateDen, color == Y4M_COLOR_GBR ? " XPLANES=GBR" : "");
+
+  return Write(header, static_cast<size_t>(length));
+}
+
+void CY4MWriter::Close()
+{
+  if (m_bOpen)
+  {
+    m_file.Close();
+    m_bOpen = false;
+  }
+
+  m_bHasFrame = false;
+  m_planes.clear();
+  m_planes.shrink_to_fit();
+}
+
+bool CY4MWriter::WriteFrame(const uint8_t* data, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  if (!m_bOpen)
+    return false;
+
+  const unsigned int width = m_width;
+  const unsigned int height = m_height;
+
+  switch (format)
+  {
+  case GAME_PIXEL_FORMAT_RGB565:
+    m_converter.ConvertRGB565(data, width, height, pitch);
+    data = m_converter.Data();
+    pitch = m_converter.Pitch();
+    break;
+  case GAME_PIXEL_FORMAT_0RGB1555:
+    m_converter.Convert0RGB1555(data, width, height, pitch);
+    data = m_converter.Data();
+    pitch = m_converter.Pitch();
+    break;
+  default:
+    break;
+  }
+
+  const size_t planeSize = static_cast<size_t>(width) * height;
+  m_planes.resize(planeSize * 3);
+
+  if (m_color == Y4M_COLOR_GBR)
+  {
+    uint8_t* planeG = m_planes.data();
+    uint8_t* planeB = planeG + planeSize;
+    uint8_t* planeR = planeB + planeSize;
+
+    for (unsigned int y = 0; y < height; y++)
+    {
+      const uint32_t* row = reinterpret_cast<const uint32_t*>(data + y * pitch);
+
+      for (unsigned int x = 0; x < width; x++)
+      {
+        *planeG++ = static_cast<uint8_t>(row[x] >> 8);
+        *planeB++ = static_cast<uint8_t>(row[x]);
+        *planeR++ = static_cast<uint8_t>(row[x] >> 16);
+      }
+    }
+  }
+  else
+  {
+    uint8_t* planeY = m_planes.data();
+    uint8_t* planeCb = planeY + planeSize;
+    uint8_t* planeCr = planeCb + planeSize;
+
+    // Full range BT.601 in 8-bit fixed point
+    for (unsigned int y = 0; y < height; y++)
+    {
+      const uint32_t* row = reinterpret_cast<const uint32_t*>(data + y * pitch);
+
+      for (unsigned int x = 0; x < width; x++)
+      {
+        const int r = (row[x] >> 16) & 0xff;
+        const int g = (row[x] >> 8) & 0xff;
+        const int b = row[x] & 0xff;
+
+        *planeY++ = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        *planeCb++ = static_cast<uint8_t>(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+        *planeCr++ = static_cast<uint8_t>(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+      }
+    }
+  }
+
+  m_bHasFrame = true;
+
+  return RepeatFrame();
+}
+
+bool CY4MWriter::RepeatFrame()
+{
+  static const char frameHeader[] = "FRAME\n";
+
+  if (!m_bOpen || !m_bHasFrame)
+    return false;
+
+  return Write(frameHeader, sizeof(frameHeader) - 1) && Write(m_planes.data(), m_planes.size());
+}
+
+bool CY4MWriter::Write(const void* data, size_t size)
+{
+  if (m_file.Write(data, size) != static_cast<ssize_t>(size))
+  {
+    esyslog("Y4M: failed to write, closing file");
+    Close();
+    return false;
+  }
+
+  m_writtenBytes += size;
+
+  return true;
+}
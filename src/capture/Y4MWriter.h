@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "video/PixelConverter.h"
+
+#include <kodi/Filesystem.h>
+#include <kodi/addon-instance/Game.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief How frames are stored in a Y4M file
+   */
+  enum Y4M_COLOR
+  {
+    /*!
+     * \brief The G, B and R channels as the three 4:4:4 planes, marked with
+     *        the XPLANES=GBR tag
+     *
+     * Lossless. This is the plane order of planar RGB in FFmpeg (gbrp), but
+     * players that ignore the tag show wrong colors.
+     */
+    Y4M_COLOR_GBR,
+
+    /*!
+     * \brief Full range BT.601 YUV, for viewing the file in any player
+     *
+     * The conversion rounds, so the RGB frames can't be recovered exactly.
+     */
+    Y4M_COLOR_YUV,
+  };
+
+  /*!
+   * \brief Writes uncompressed video to a Y4M file
+   *
+   * Y4M has no RGB layout, so frames are stored as 4:4:4 planes, either as
+   * RGB channels or converted to YUV (see Y4M_COLOR). 16-bit frames are
+   * expanded to 8 bits per channel first. The output is deterministic: the
+   * same frames always give the same file.
+   */
+  class CY4MWriter
+  {
+  public:
+    CY4MWriter() = default;
+    ~CY4MWriter() { Close(); }
+
+    /*!
+     * \brief Create the file and write the stream header
+     *
+     * The frame rate is given as a fraction, e.g. 60000 / 1001.
+     */
+    bool Open(const std::string& path, unsigned int width, unsigned int height, unsigned int frameRateNum, unsigned int frameRateDen, Y4M_COLOR color);
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+
+    unsigned int Width() const { return m_width; }
+    unsigned int Height() const { return m_height; }
+
+    /*!
+     * \brief Convert and write a frame of the size given to Open()
+     *
+     * \return False if writing failed, the file is unusable afterwards
+     */
+    bool WriteFrame(const uint8_t* data, size_t pitch, GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief Write the last frame again
+     */
+    bool RepeatFrame();
+
+    bool HasFrame() const { return m_bHasFrame; }
+
+    /*!
+     * \brief Bytes written to the current or last file
+     */
+    uint64_t WrittenBytes() const { return m_writtenBytes; }
+
+  private:
+    bool Write(const void* data, size_t size);
+
+    kodi::vfs::CFile m_file;
+    bool m_bOpen = false;
+    unsigned int m_width = 0;
+    unsigned int m_height = 0;
+    Y4M_COLOR m_color = Y4M_COLOR_GBR;
+
+    CPixelConverter m_converter;
+    std::vector<uint8_t> m_planes; // The three planes of the last frame
+    bool m_bHasFrame = false;
+
+    uint64_t m_writtenBytes = 0;
+  };
+}
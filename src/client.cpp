@@ -5,20 +5,28 @@
  *  See LICENSE.md for more information.
  */
 
+#include "capture/InstantReplay.h"
+#include "capture/MediaCapture.h"
 #include "cheevos/Cheevos.h"
 #include "cheevos/CheevosEnvironment.h"
+#include "frameloop/CoreRunner.h"
 #include "input/ButtonMapper.h"
 #include "input/ControllerTopology.h"
 #include "input/InputManager.h"
+#include "input/InputMovie.h"
 #include "libretro-common/libretro.h"
+#include "libretro/CpuFeatures.h"
 #include "libretro/LibretroEnvironment.h"
+#include "libretro/PerfCounters.h"
 #include "log/Log.h"
 #include "log/LogAddon.h"
 #include "settings/Settings.h"
+#include "utils/FrameProfiler.h"
 #include "GameInfoLoader.h"
 
 #include "client.h"
 
+#include <kodi/Filesystem.h>
 #include <set>
 #include <string>
 #include <vector>
@@ -49,6 +57,9 @@ CGameLibRetro::~CGameLibRetro()
 
   m_client.retro_deinit();
 
+  // Counters are owned by the core
+  CPerfCounters::Get().Clear();
+
   CControllerTopology::GetInstance().Clear();
 
   CLibretroEnvironment::Get().Deinitialize();
@@ -71,6 +82,9 @@ ADDON_STATUS CGameLibRetro::Create()
 
     CLog::Get().SetType(SYS_LOG_TYPE_ADDON);
 
+    // Cores may ask for CPU features as early as retro_init()
+    CCpuFeatures::Get().Detect();
+
     if (!m_client.Load(dllPath))
     {
       esyslog("Failed to load %s", dllPath.c_str());
@@ -184,7 +198,12 @@ GAME_ERROR CGameLibRetro::LoadGame(const std::string& url)
     bResult = m_client.retro_load_game(&gameInfo);
   }
 
-  return bResult ? GAME_ERROR_NO_ERROR : GAME_ERROR_FAILED;
+  if (!bResult)
+    return GAME_ERROR_FAILED;
+
+  OnGameLoaded(url);
+
+  return GAME_ERROR_NO_ERROR;
 }
 
 GAME_ERROR CGameLibRetro::LoadGameSpecial(SPECIAL_GAME_TYPE type, const std::vector<std::string>& urls)
@@ -227,17 +246,150 @@ GAME_ERROR CGameLibRetro::LoadStandalone()
   if (!m_client.retro_load_game(nullptr))
     return GAME_ERROR_FAILED;
 
+  OnGameLoaded("");
+
   return GAME_ERROR_NO_ERROR;
 }
 
+void CGameLibRetro::OnGameLoaded(const std::string& gamePath)
+{
+  CLibretroEnvironment::Get().StateCapabilities().ResetSession();
+
+  // Kodi asks for the timing after the game is loaded, but captures need
+  // the frame rate and sample rate to start
+  retro_system_av_info retro_info = { };
+  m_client.retro_get_system_av_info(&retro_info);
+  CLibretroEnvironment::Get().UpdateTiming(retro_info.timing);
+
+  CFrameProfiler::Get().Reset();
+  CFrameProfiler::Get().SetEnabled(CSettings::Get().FrameProfiling());
+
+  m_frameClock.Reset();
+
+  unsigned int runAheadFrames = CSettings::Get().RunAheadFrames();
+
+  if (StartInputMovie(gamePath) && runAheadFrames > 0)
+  {
+    // Rolling back would record or consume the same frames more than once
+    isyslog("Disabling run-ahead while an input movie is active");
+    runAheadFrames = 0;
+  }
+
+  if (CSettings::Get().PreemptiveFrames())
+    m_preemptiveFrames.Initialize(&m_client, runAheadFrames);
+  else
+    m_runAhead.Initialize(&m_client, runAheadFrames);
+
+  const size_t rewindBudget = static_cast<size_t>(CSettings::Get().RewindBufferMB()) * 1024 * 1024;
+  m_rewind.Initialize(&m_client, rewindBudget, CSettings::Get().RewindInterval());
+
+  m_saveStates.Initialize(&m_client);
+
+  if (CSettings::Get().DirtyPageTracking())
+    m_dirtyPages.Initialize(CLibretroEnvironment::Get().GetMemoryMap());
+
+  if (CSettings::Get().MediaCapture())
+    StartMediaCapture(gamePath);
+
+  const size_t replayBudget = static_cast<size_t>(CSettings::Get().ReplayBufferMB()) * 1024 * 1024;
+  CInstantReplay::Get().Initialize(CSettings::Get().ReplayDuration(), replayBudget,
+      CLibretroEnvironment::Get().GetFrameRate(), CLibretroEnvironment::Get().GetSampleRate(),
+      CSettings::Get().CaptureYUV() ? Y4M_COLOR_YUV : Y4M_COLOR_GBR);
+}
+
+bool CGameLibRetro::StartInputMovie(const std::string& gamePath)
+{
+  const INPUT_MOVIE_MODE mode = CSettings::Get().InputMovieMode();
+  if (mode == INPUT_MOVIE_OFF)
+    return false;
+
+  std::string folder = CSettings::Get().InputMovieFolder();
+  if (folder.empty())
+    folder = CLibretroEnvironment::Get().GetSaveDirectory();
+
+  if (!folder.empty() && folder.back() != '/' && folder.back() != '\\')
+    folder += '/';
+
+  const std::string name = gamePath.empty() ? "standalone" : kodi::vfs::GetFileName(gamePath);
+  const std::string path = folder + name + ".lrmovie";
+
+  if (mode == INPUT_MOVIE_RECORD)
+    return CInputMovie::Get().StartRecording(path, m_client);
+
+  return CInputMovie::Get().StartPlayback(path, m_client);
+}
+
+void CGameLibRetro::StartMediaCapture(const std::string& gamePath)
+{
+  std::string folder = CSettings::Get().MediaCaptureFolder();
+  if (folder.empty())
+    folder = CLibretroEnvironment::Get().GetSaveDirectory();
+
+  if (!folder.empty() && folder.back() != '/' && folder.back() != '\\')
+    folder += '/';
+
+  const std::string name = gamePath.empty() ? "standalone" : kodi::vfs::GetFileName(gamePath);
+
+  CMediaCapture::Get().Start(folder + name, CLibretroEnvironment::Get().GetFrameRate(),
+      CLibretroEnvironment::Get().GetSampleRate(), CSettings::Get().CaptureYUV() ? Y4M_COLOR_YUV : Y4M_COLOR_GBR);
+}
+
 GAME_ERROR CGameLibRetro::UnloadGame()
 {
   GAME_ERROR error = GAME_ERROR_FAILED;
 
+  // Wait for save states that are still being written
+  m_saveStates.Deinitialize();
+  m_saveStates.LogStatistics();
+
+  CInputMovie::Get().Stop();
+
+  // Write the frames that are still queued
+  CMediaCapture::Get().Stop();
+  CMediaCapture::Get().LogStatistics();
+
+  // Finish a replay clip that is still being written
+  CInstantReplay::Get().LogStatistics();
+  CInstantReplay::Get().Deinitialize();
+
+  m_runAhead.Deinitialize();
+
+  if (m_preemptiveFrames.IsEnabled())
+    m_preemptiveFrames.LogStatistics();
+  m_preemptiveFrames.Deinitialize();
+
+  m_fastForward.LogStatistics();
+  m_fastForward.ResetStatistics();
+
+  m_frameSkip.LogStatistics();
+  m_frameSkip.Reset();
+
+  if (m_rewind.IsEnabled())
+    m_rewind.LogStatistics();
+  m_rewind.Deinitialize();
+
+  m_dirtyPages.LogStatistics();
+  m_dirtyPages.Deinitialize();
+
+  CLibretroEnvironment::Get().Video().LogStatistics();
+  CLibretroEnvironment::Get().Video().ResetStatistics();
+
+  CLibretroEnvironment::Get().SetFastForwarding(false);
+
   m_client.retro_unload_game();
 
+  CLibretroEnvironment::Get().StateCapabilities().ResetSession();
+
   CLibretroEnvironment::Get().CloseStreams();
 
+  if (CFrameProfiler::Get().IsEnabled())
+  {
+    CFrameProfiler::Get().LogStatistics();
+    m_frameClock.LogStatistics();
+    CPerfCounters::Get().Log();
+  }
+  CFrameProfiler::Get().Reset();
+
   error = GAME_ERROR_NO_ERROR;
 
   SAFE_DELETE_GAME_INFO(m_gameInfo);
@@ -255,6 +407,7 @@ GAME_ERROR CGameLibRetro::GetGameTiming(game_system_timing& timing_info)
 
   // Report info to CLibretroEnvironment
   CLibretroEnvironment::Get().UpdateVideoGeometry(retro_info.geometry);
+  CLibretroEnvironment::Get().UpdateTiming(retro_info.timing);
 
   return GAME_ERROR_NO_ERROR;
 }
@@ -266,27 +419,85 @@ GAME_REGION CGameLibRetro::GetRegion()
 
 GAME_ERROR CGameLibRetro::RunFrame()
 {
-  // Trigger the frame time callback before running the core.
-  uint64_t current = m_timer.microseconds();
-  int64_t delta = 0;
+  {
+    CFrameTimer frameTimer(FRAME_PHASE_FRAME);
+
+    // Fast-forward settings are applied immediately so it can be toggled
+    // while playing
+    m_fastForward.SetRatio(CSettings::Get().FastForwardRatio());
+    m_fastForward.SetTimeBudget(CSettings::Get().FastForwardBudgetMs());
+
+    const bool bFastForward = m_fastForward.IsEnabled();
+    CLibretroEnvironment::Get().SetFastForwarding(bFastForward);
+
+    // Trigger the frame time callback before running the core.
+    m_frameClock.SetReference(m_clientBridge.FrameTimeReference());
+    m_clientBridge.FrameTime(m_frameClock.Tick(!bFastForward));
+
+    if (bFastForward)
+    {
+      m_fastForward.RunHiddenFrames(m_client);
 
-  if (m_frameTimeLast > 0)
-    delta = current - m_frameTimeLast;
+      // Rolling back would undo the frames that were just skipped
+      m_preemptiveFrames.Invalidate();
 
-  m_frameTimeLast = current;
-  m_clientBridge.FrameTime(delta);
+      CCoreRunner::Run(m_client);
+    }
+    else
+    {
+      m_frameSkip.SetMaxSkip(CSettings::Get().MaxFrameSkip());
+      m_frameSkip.SetFrameRate(CLibretroEnvironment::Get().GetFrameRate());
+
+      const bool bShowVideo = m_frameSkip.ShouldRenderVideo();
+
+      // The cost of emulation includes any frames run ahead
+      const int64_t startNs = CFrameProfiler::Now();
+      EmulateFrame(bShowVideo);
+      m_frameSkip.AddFrameTime(CFrameProfiler::Now() - startNs);
+
+      // The audio of a skipped frame is still captured, so the video
+      // repeats the previous frame to stay in sync
+      if (!bShowVideo)
+      {
+        CMediaCapture::Get().DupeVideoFrame();
+        CInstantReplay::Get().DupeVideoFrame();
+      }
+    }
+
+    m_rewind.OnFrameEnd();
 
-  m_client.retro_run();
+    m_dirtyPages.Scan();
 
-  CLibretroEnvironment::Get().OnFrameEnd();
+    m_saveStates.ProcessCompletions();
+
+    CLibretroEnvironment::Get().OnFrameEnd();
+  }
+
+  CFrameProfiler::Get().OnFrameEnd();
 
   return GAME_ERROR_NO_ERROR;
 }
 
+void CGameLibRetro::EmulateFrame(bool bShowVideo)
+{
+  if (m_preemptiveFrames.IsEnabled())
+    m_preemptiveFrames.RunFrame(bShowVideo);
+  else if (m_runAhead.IsEnabled())
+    m_runAhead.RunFrame(bShowVideo);
+  else
+    CCoreRunner::Run(m_client, bShowVideo, true);
+}
+
 GAME_ERROR CGameLibRetro::Reset()
 {
+  // Movies don't record resets, so playback would diverge from the game
+  if (CInputMovie::Get().IsRecording() || CInputMovie::Get().IsPlaying())
+    return GAME_ERROR_REJECTED;
+
   m_client.retro_reset();
 
+  m_preemptiveFrames.Invalidate();
+
   return GAME_ERROR_NO_ERROR;
 }
 
@@ -432,7 +643,7 @@ bool CGameLibRetro::InputEvent(const game_input_event& event)
 
 size_t CGameLibRetro::SerializeSize()
 {
-  return m_client.retro_serialize_size();
+  return CLibretroEnvironment::Get().StateCapabilities().SerializeSize(m_client);
 }
 
 GAME_ERROR CGameLibRetro::Serialize(uint8_t* data, size_t size)
@@ -440,7 +651,7 @@ GAME_ERROR CGameLibRetro::Serialize(uint8_t* data, size_t size)
   if (data == nullptr)
     return GAME_ERROR_INVALID_PARAMETERS;
 
-  bool result = m_client.retro_serialize(data, size);
+  bool result = CLibretroEnvironment::Get().StateCapabilities().Serialize(m_client, data, size);
 
   return result ? GAME_ERROR_NO_ERROR : GAME_ERROR_FAILED;
 }
@@ -450,11 +661,70 @@ GAME_ERROR CGameLibRetro::Deserialize(const uint8_t* data, size_t size)
   if (data == nullptr)
     return GAME_ERROR_INVALID_PARAMETERS;
 
+  // Loading would make the recorded input diverge from the game
+  if (CInputMovie::Get().IsRecording() || CInputMovie::Get().IsPlaying())
+    return GAME_ERROR_REJECTED;
+
   bool result = m_client.retro_unserialize(data, size);
 
+  m_preemptiveFrames.Invalidate();
+
   return result ? GAME_ERROR_NO_ERROR : GAME_ERROR_FAILED;
 }
 
+GAME_ERROR CGameLibRetro::Rewind(unsigned int steps)
+{
+  if (!m_rewind.IsEnabled())
+    return GAME_ERROR_NOT_IMPLEMENTED;
+
+  // Rewinding would make the recorded input diverge from the game
+  if (CInputMovie::Get().IsRecording() || CInputMovie::Get().IsPlaying())
+    return GAME_ERROR_REJECTED;
+
+  if (m_rewind.StepBack(steps) == 0)
+    return GAME_ERROR_FAILED;
+
+  m_preemptiveFrames.Invalidate();
+
+  return GAME_ERROR_NO_ERROR;
+}
+
+GAME_ERROR CGameLibRetro::SaveState(const std::string& path, SaveStateCallback callback)
+{
+  if (path.empty())
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  return m_saveStates.Save(path, std::move(callback)) ? GAME_ERROR_NO_ERROR : GAME_ERROR_FAILED;
+}
+
+GAME_ERROR CGameLibRetro::SaveReplay(const std::string& basePath)
+{
+  if (basePath.empty())
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  if (!CInstantReplay::Get().IsEnabled())
+    return GAME_ERROR_NOT_IMPLEMENTED;
+
+  return CInstantReplay::Get().SaveClip(basePath) ? GAME_ERROR_NO_ERROR : GAME_ERROR_FAILED;
+}
+
+GAME_ERROR CGameLibRetro::LoadState(const std::string& path)
+{
+  if (path.empty())
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  // Loading would make the recorded input diverge from the game
+  if (CInputMovie::Get().IsRecording() || CInputMovie::Get().IsPlaying())
+    return GAME_ERROR_REJECTED;
+
+  if (!m_saveStates.Load(path))
+    return GAME_ERROR_FAILED;
+
+  m_preemptiveFrames.Invalidate();
+
+  return GAME_ERROR_NO_ERROR;
+}
+
 GAME_ERROR CGameLibRetro::CheatReset()
 {
   m_client.retro_cheat_reset();
@@ -7,9 +7,16 @@
 
 #pragma once
 
+#include "frameloop/FastForward.h"
+#include "frameloop/FrameSkip.h"
+#include "frameloop/PreemptiveFrames.h"
+#include "frameloop/RunAhead.h"
 #include "libretro/ClientBridge.h"
 #include "libretro/LibretroDLL.h"
-#include "utils/Timer.h"
+#include "savestate/DirtyPageTracker.h"
+#include "savestate/Rewind.h"
+#include "savestate/SaveStateService.h"
+#include "utils/FrameClock.h"
 
 #include <kodi/addon-instance/Game.h>
 
@@ -63,6 +70,40 @@ public:
   GAME_ERROR Serialize(uint8_t* data, size_t size) override;
   GAME_ERROR Deserialize(const uint8_t* data, size_t size) override;
 
+  /*!
+   * \brief Restore a state from the rewind history
+   *
+   * \param steps The number of snapshots to go back
+   *
+   * This function is not part of the Game API yet.
+   */
+  GAME_ERROR Rewind(unsigned int steps);
+
+  /*!
+   * \brief Save the state to a file without blocking emulation
+   *
+   * \param path The file to write
+   * \param callback Invoked from the frame loop when the file is written
+   *
+   * This function is not part of the Game API yet.
+   */
+  GAME_ERROR SaveState(const std::string& path, LIBRETRO::SaveStateCallback callback);
+
+  /*!
+   * \brief Load a state from a file written by SaveState()
+   *
+   * This function is not part of the Game API yet.
+   */
+  GAME_ERROR LoadState(const std::string& path);
+
+  /*!
+   * \brief Save the instant replay buffer to <basePath>.y4m and
+   *        <basePath>.wav in the background
+   *
+   * This function is not part of the Game API yet.
+   */
+  GAME_ERROR SaveReplay(const std::string& basePath);
+
   // --- Cheat operations --------------------------------------------------------
 
   GAME_ERROR CheatReset() override;
@@ -91,10 +132,38 @@ public:
 private:
   GAME_ERROR AudioAvailable();
 
-  LIBRETRO::Timer                         m_timer;
+  /*!
+   * \brief Prepare the frame loop after a game has been loaded
+   */
+  void OnGameLoaded(const std::string& gamePath);
+
+  /*!
+   * \brief Start recording or playing back an input movie, if enabled
+   *
+   * \param gamePath The path of the loaded game, or empty if standalone
+   *
+   * \return True if a movie is being recorded or played back
+   */
+  bool StartInputMovie(const std::string& gamePath);
+  void StartMediaCapture(const std::string& gamePath);
+
+  /*!
+   * \brief Emulate a presented frame, running ahead if enabled
+   *
+   * \param bShowVideo False if the video of this frame should be skipped
+   */
+  void EmulateFrame(bool bShowVideo);
+
+  LIBRETRO::CFrameClock                   m_frameClock;
   LIBRETRO::CLibretroDLL                  m_client;
   LIBRETRO::CClientBridge                 m_clientBridge;
+  LIBRETRO::CRunAhead                     m_runAhead;
+  LIBRETRO::CPreemptiveFrames             m_preemptiveFrames;
+  LIBRETRO::CFastForward                  m_fastForward;
+  LIBRETRO::CFrameSkip                    m_frameSkip;
+  LIBRETRO::CRewind                       m_rewind;
+  LIBRETRO::CSaveStateService             m_saveStates;
+  LIBRETRO::CDirtyPageTracker             m_dirtyPages;
   std::vector<LIBRETRO::CGameInfoLoader*> m_gameInfo;
   bool                                    m_supportsVFS = false; // TODO
-  int64_t                                 m_frameTimeLast = 0;
 };
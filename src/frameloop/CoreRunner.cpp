@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "CoreRunner.h"
+#include "input/InputMovie.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "utils/FrameProfiler.h"
+
+using namespace LIBRETRO;
+
+void CCoreRunner::Run(CLibretroDLL& client, bool bVideo, bool bAudio)
+{
+  const bool bSuppressed = !bVideo || !bAudio;
+
+  if (bSuppressed)
+    CLibretroEnvironment::Get().SetAudioVideoEnabled(bVideo, bAudio);
+
+  CInputMovie::Get().OnFrameBegin();
+
+  {
+    CFrameTimer coreTimer(FRAME_PHASE_CORE);
+    client.retro_run();
+  }
+
+  if (bSuppressed)
+    CLibretroEnvironment::Get().SetAudioVideoEnabled(true, true);
+}
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Run a single frame of the core with optional output suppression
+   *
+   * Shared by the frame loop strategies that emulate frames the user never
+   * sees or hears.
+   */
+  class CCoreRunner
+  {
+  public:
+    /*!
+     * \brief Call retro_run() once, timed as the core phase of the frame
+     *
+     * \param client The libretro core
+     * \param bVideo False to drop the video of this frame
+     * \param bAudio False to drop the audio of this frame
+     */
+    static void Run(CLibretroDLL& client, bool bVideo = true, bool bAudio = true);
+  };
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FastForward.h"
+#include "CoreRunner.h"
+#include "log/Log.h"
+
+#include <chrono>
+
+using namespace LIBRETRO;
+
+// Bound the loop when the core is much faster than the time budget
+#define MAX_HIDDEN_FRAMES  1000
+
+void CFastForward::SetRatio(unsigned int ratio)
+{
+  m_ratio = ratio > 0 ? ratio : 1;
+}
+
+void CFastForward::SetTimeBudget(unsigned int budgetMs)
+{
+  m_timeBudgetMs = budgetMs;
+}
+
+void CFastForward::RunHiddenFrames(CLibretroDLL& client)
+{
+  m_presentedFrames++;
+
+  if (m_timeBudgetMs > 0)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_timeBudgetMs);
+
+    for (unsigned int i = 0; i < MAX_HIDDEN_FRAMES; i++)
+    {
+      if (std::chrono::steady_clock::now() >= deadline)
+        break;
+
+      CCoreRunner::Run(client, false, false);
+      m_hiddenFrames++;
+    }
+  }
+  else
+  {
+    for (unsigned int i = 1; i < m_ratio; i++)
+    {
+      CCoreRunner::Run(client, false, false);
+      m_hiddenFrames++;
+    }
+  }
+}
+
+void CFastForward::LogStatistics() const
+{
+  if (m_presentedFrames == 0)
+    return;
+
+  const uint64_t totalFrames = m_presentedFrames + m_hiddenFrames;
+
+  isyslog("Fast-forward: %llu frames emulated for %llu presented frames (%.1fx)",
+      static_cast<unsigned long long>(totalFrames),
+      static_cast<unsigned long long>(m_presentedFrames),
+      static_cast<double>(totalFrames) / m_presentedFrames);
+}
+
+void CFastForward::ResetStatistics()
+{
+  m_presentedFrames = 0;
+  m_hiddenFrames = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Emulate several frames for every frame presented
+   *
+   * Fast-forward runs either a fixed number of frames per presented frame,
+   * or as many frames as fit in a time budget. All frames but the last are
+   * emulated with video and audio suppressed, so the frontend only sees a
+   * normal stream of frames while the game runs faster. Audio is decimated
+   * by the same ratio as video.
+   */
+  class CFastForward
+  {
+  public:
+    CFastForward() = default;
+
+    /*!
+     * \brief Set the number of frames emulated per presented frame
+     *
+     * \param ratio The ratio, or 1 to disable a fixed ratio
+     */
+    void SetRatio(unsigned int ratio);
+
+    /*!
+     * \brief Run unthrottled until the time budget of a frame is spent
+     *
+     * A time budget takes precedence over the ratio.
+     *
+     * \param budgetMs The time budget in milliseconds, or 0 to disable
+     */
+    void SetTimeBudget(unsigned int budgetMs);
+
+    bool IsEnabled() const { return m_ratio > 1 || m_timeBudgetMs > 0; }
+
+    /*!
+     * \brief Emulate the frames that are skipped before a presented frame
+     *
+     * The caller is responsible for running the presented frame afterwards.
+     *
+     * \param client The libretro core
+     */
+    void RunHiddenFrames(CLibretroDLL& client);
+
+    /*!
+     * \brief Log how many frames were emulated while fast-forwarding
+     */
+    void LogStatistics() const;
+
+    void ResetStatistics();
+
+  private:
+    unsigned int m_ratio = 1;
+    unsigned int m_timeBudgetMs = 0;
+
+    // Statistics
+    uint64_t m_presentedFrames = 0;
+    uint64_t m_hiddenFrames = 0;
+  };
+}
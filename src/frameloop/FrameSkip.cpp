@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FrameSkip.h"
+#include "log/Log.h"
+
+using namespace LIBRETRO;
+
+// Weight of a new sample in the exponential moving average
+#define AVERAGE_SMOOTHING     0.1
+
+// Raise the skip level when emulation takes more than this fraction of the
+// frame budget, leaving time for the frontend
+#define OVERLOAD_THRESHOLD    0.9
+
+// Lower the skip level when emulation takes less than this fraction
+#define UNDERLOAD_THRESHOLD   0.6
+
+// Number of frames the average needs to settle after a level change
+#define MIN_FRAMES_AT_LEVEL   30
+
+void CFrameSkip::SetMaxSkip(unsigned int maxSkip)
+{
+  m_maxSkip = maxSkip;
+
+  if (m_skipLevel > m_maxSkip)
+    SetSkipLevel(m_maxSkip);
+}
+
+void CFrameSkip::SetFrameRate(double fps)
+{
+  if (fps == m_frameRate)
+    return;
+
+  m_frameRate = fps;
+  m_budgetNs = fps > 0.0 ? static_cast<int64_t>(1000000000.0 / fps) : 0;
+}
+
+bool CFrameSkip::ShouldRenderVideo()
+{
+  if (!IsEnabled())
+    return true;
+
+  m_frames++;
+
+  if (m_framesUntilRender == 0)
+  {
+    m_framesUntilRender = m_skipLevel;
+    return true;
+  }
+
+  m_framesUntilRender--;
+  m_skippedFrames++;
+
+  return false;
+}
+
+void CFrameSkip::AddFrameTime(int64_t durationNs)
+{
+  if (!IsEnabled())
+    return;
+
+  if (m_averageNs <= 0.0)
+    m_averageNs = static_cast<double>(durationNs);
+  else
+    m_averageNs += (durationNs - m_averageNs) * AVERAGE_SMOOTHING;
+
+  if (++m_framesAtLevel < MIN_FRAMES_AT_LEVEL)
+    return;
+
+  if (m_averageNs > m_budgetNs * OVERLOAD_THRESHOLD)
+  {
+    if (m_skipLevel < m_maxSkip)
+      SetSkipLevel(m_skipLevel + 1);
+  }
+  else if (m_averageNs < m_budgetNs * UNDERLOAD_THRESHOLD)
+  {
+    if (m_skipLevel > 0)
+      SetSkipLevel(m_skipLevel - 1);
+  }
+}
+
+void CFrameSkip::SetSkipLevel(unsigned int skipLevel)
+{
+  dsyslog("Frameskip: average frame time %.2f ms (budget %.2f ms), skip level %u -> %u",
+      m_averageNs / 1000000.0, m_budgetNs / 1000000.0, m_skipLevel, skipLevel);
+
+  m_skipLevel = skipLevel;
+  m_framesUntilRender = 0;
+  m_framesAtLevel = 0;
+
+  if (m_skipLevel > m_highestSkipLevel)
+    m_highestSkipLevel = m_skipLevel;
+}
+
+void CFrameSkip::LogStatistics() const
+{
+  if (m_frames == 0)
+    return;
+
+  isyslog("Frameskip: skipped video of %llu of %llu frames (%.1f%%), highest skip level %u",
+      static_cast<unsigned long long>(m_skippedFrames),
+      static_cast<unsigned long long>(m_frames),
+      100.0 * m_skippedFrames / m_frames,
+      m_highestSkipLevel);
+}
+
+void CFrameSkip::Reset()
+{
+  m_averageNs = 0.0;
+  m_skipLevel = 0;
+  m_framesUntilRender = 0;
+  m_framesAtLevel = 0;
+  m_frames = 0;
+  m_skippedFrames = 0;
+  m_highestSkipLevel = 0;
+}
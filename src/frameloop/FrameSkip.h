@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Adaptive frameskip driven by the measured cost of emulation
+   *
+   * A moving average of the time spent emulating each frame is compared
+   * against the frame budget derived from the core's frame rate. When the
+   * core can't keep up, the skip level is raised so that video is rendered
+   * only every (level + 1) frames. Audio is unaffected and stays
+   * continuous. The level changes by one step at a time, only after it has
+   * been stable for a while, and the thresholds for raising and lowering it
+   * are apart to avoid oscillating.
+   */
+  class CFrameSkip
+  {
+  public:
+    CFrameSkip() = default;
+
+    /*!
+     * \brief Set the maximum number of consecutive frames to skip
+     *
+     * \param maxSkip The maximum skip, or 0 to disable frameskip
+     */
+    void SetMaxSkip(unsigned int maxSkip);
+
+    /*!
+     * \brief Set the frame rate that determines the time budget of a frame
+     */
+    void SetFrameRate(double fps);
+
+    bool IsEnabled() const { return m_maxSkip > 0 && m_budgetNs > 0; }
+
+    /*!
+     * \brief Decide whether the video of the next frame should be rendered
+     */
+    bool ShouldRenderVideo();
+
+    /*!
+     * \brief Report the time it took to emulate a frame
+     *
+     * \param durationNs The duration in nanoseconds
+     */
+    void AddFrameTime(int64_t durationNs);
+
+    unsigned int SkipLevel() const { return m_skipLevel; }
+
+    /*!
+     * \brief Log how many frames were skipped
+     */
+    void LogStatistics() const;
+
+    void Reset();
+
+  private:
+    void SetSkipLevel(unsigned int skipLevel);
+
+    // Configuration
+    unsigned int m_maxSkip = 0;
+    double m_frameRate = 0.0;
+    int64_t m_budgetNs = 0;
+
+    // Controller state
+    double m_averageNs = 0.0;
+    unsigned int m_skipLevel = 0;
+    unsigned int m_framesUntilRender = 0;
+    unsigned int m_framesAtLevel = 0;
+
+    // Statistics
+    uint64_t m_frames = 0;
+    uint64_t m_skippedFrames = 0;
+    unsigned int m_highestSkipLevel = 0;
+  };
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "PreemptiveFrames.h"
+#include "CoreRunner.h"
+#include "input/InputManager.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "log/Log.h"
+
+#include <utility>
+
+using namespace LIBRETRO;
+
+void CPreemptiveFrames::Initialize(CLibretroDLL* client, unsigned int frameCount)
+{
+  m_client = client;
+  m_frameCount = frameCount;
+  m_frames = 0;
+  m_rollbacks = 0;
+
+  if (!IsEnabled())
+    return;
+
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  const size_t stateSize = capabilities.SerializeSize(*m_client);
+  if (stateSize == 0 && !capabilities.IsInitializing())
+  {
+    esyslog("Preemptive frames: core doesn't support save states, disabling");
+    Disable();
+    return;
+  }
+
+  // Preallocate the ring so that saving states doesn't allocate
+  m_states.resize(m_frameCount);
+  for (SavedState& state : m_states)
+    state.data.resize(stateSize);
+
+  Invalidate();
+
+  isyslog("Preemptive frames: enabled with %u frame(s), state size %u bytes", m_frameCount,
+      static_cast<unsigned int>(stateSize));
+}
+
+void CPreemptiveFrames::Deinitialize()
+{
+  m_client = nullptr;
+  m_frameCount = 0;
+  m_states.clear();
+  m_states.shrink_to_fit();
+  Invalidate();
+}
+
+void CPreemptiveFrames::Invalidate()
+{
+  m_nextState = 0;
+  m_stateCount = 0;
+  m_previousInput.clear();
+}
+
+void CPreemptiveFrames::RunFrame(bool bShowVideo)
+{
+  if (!IsEnabled())
+    return;
+
+  m_frames++;
+
+  CInputManager::Get().GetInputSnapshot(m_currentInput);
+  const bool bInputChanged = (m_currentInput != m_previousInput);
+  std::swap(m_previousInput, m_currentInput);
+
+  // Until the ring is full there is nothing to roll back to
+  if (bInputChanged && m_stateCount == m_frameCount)
+    Rollback();
+
+  // The frame is emulated even if saving the state fails, in which case
+  // preemptive frames have been disabled or the core is still initializing
+  if (IsEnabled() && SaveState(m_states[m_nextState]))
+  {
+    m_nextState = (m_nextState + 1) % m_frameCount;
+    if (m_stateCount < m_frameCount)
+      m_stateCount++;
+  }
+
+  CCoreRunner::Run(*m_client, bShowVideo, true);
+}
+
+void CPreemptiveFrames::Rollback()
+{
+  if (!LoadState(m_states[m_nextState]))
+    return;
+
+  m_rollbacks++;
+
+  // Emulate the last N frames again with the new input. The states saved
+  // before them are now out of date, except for the one just loaded.
+  const unsigned int frameCount = m_frameCount;
+  for (unsigned int i = 0; i < frameCount; i++)
+  {
+    if (i > 0 && !SaveState(m_states[(m_nextState + i) % frameCount]))
+      return;
+
+    CCoreRunner::Run(*m_client, false, false);
+  }
+}
+
+void CPreemptiveFrames::LogStatistics() const
+{
+  if (m_frames == 0)
+    return;
+
+  const double percent = 100.0 * m_rollbacks / m_frames;
+
+  isyslog("Preemptive frames: %llu rollback(s) in %llu frames (%.1f%%)",
+      static_cast<unsigned long long>(m_rollbacks),
+      static_cast<unsigned long long>(m_frames),
+      percent);
+}
+
+bool CPreemptiveFrames::SaveState(SavedState& state)
+{
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  state.size = capabilities.SerializeSize(*m_client);
+  if (state.size > state.data.size())
+    state.data.resize(state.size);
+
+  if (!capabilities.Serialize(*m_client, state.data.data(), state.size))
+  {
+    // Failures are expected until the core is initialized
+    if (capabilities.IsInitializing())
+      return false;
+
+    esyslog("Preemptive frames: failed to save state, disabling");
+    Disable();
+    return false;
+  }
+
+  return true;
+}
+
+bool CPreemptiveFrames::LoadState(const SavedState& state)
+{
+  if (!m_client->retro_unserialize(state.data.data(), state.size))
+  {
+    esyslog("Preemptive frames: failed to restore state, disabling");
+    Disable();
+    return false;
+  }
+
+  return true;
+}
+
+void CPreemptiveFrames::Disable()
+{
+  m_frameCount = 0;
+}
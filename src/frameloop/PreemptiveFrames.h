@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Input latency reduction by rolling back only when input changes
+   *
+   * Keeps a ring of the states saved before each of the last N frames. While
+   * the input stays the same, a frame costs one emulated frame plus one
+   * serialize. When the input changes, the core is rolled back N frames and
+   * those frames are emulated again, hidden, with the new input. The result
+   * is the same as run-ahead, which assumes every frame that the input of
+   * the last N frames was the current input.
+   */
+  class CPreemptiveFrames
+  {
+  public:
+    CPreemptiveFrames() = default;
+
+    /*!
+     * \brief Prepare preemptive frames for a loaded game
+     *
+     * \param client The libretro core
+     * \param frameCount The number of frames to roll back, or 0 to disable
+     */
+    void Initialize(CLibretroDLL* client, unsigned int frameCount);
+    void Deinitialize();
+
+    bool IsEnabled() const { return m_client != nullptr && m_frameCount > 0; }
+
+    /*!
+     * \brief Emulate a frame, rolling back first if the input has changed
+     *
+     * If the core's state can't be saved or restored, preemptive frames are
+     * disabled and following frames should be run normally.
+     *
+     * \param bShowVideo False to suppress the video of this frame entirely
+     */
+    void RunFrame(bool bShowVideo);
+
+    /*!
+     * \brief Forget the saved states, e.g. after the game was reset or a
+     *        save state was loaded
+     */
+    void Invalidate();
+
+    /*!
+     * \brief Log how often input changes caused a rollback
+     */
+    void LogStatistics() const;
+
+  private:
+    struct SavedState
+    {
+      std::vector<uint8_t> data;
+      size_t size = 0;
+    };
+
+    void Rollback();
+    bool SaveState(SavedState& state);
+    bool LoadState(const SavedState& state);
+    void Disable();
+
+    CLibretroDLL* m_client = nullptr;
+    unsigned int m_frameCount = 0;
+
+    // Ring of states saved before each of the last N frames
+    std::vector<SavedState> m_states;
+    unsigned int m_nextState = 0; // Oldest state once the ring is full
+    unsigned int m_stateCount = 0;
+
+    // Input snapshots, reused to avoid allocations
+    std::vector<int32_t> m_previousInput;
+    std::vector<int32_t> m_currentInput;
+
+    // Statistics
+    uint64_t m_frames = 0;
+    uint64_t m_rollbacks = 0;
+  };
+}
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "RunAhead.h"
+#include "CoreRunner.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "log/Log.h"
+
+using namespace LIBRETRO;
+
+void CRunAhead::Initialize(CLibretroDLL* client, unsigned int frameCount)
+{
+  m_client = client;
+  m_frameCount = frameCount;
+
+  if (!IsEnabled())
+    return;
+
+  // Preallocate the state buffer. Cores with variable-size states, or that
+  // are still initializing, may need it to grow later.
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  m_stateSize = capabilities.SerializeSize(*m_client);
+  if (m_stateSize == 0 && !capabilities.IsInitializing())
+  {
+    esyslog("Run-ahead: core doesn't support save states, disabling");
+    Disable();
+    return;
+  }
+
+  m_state.resize(m_stateSize);
+
+  isyslog("Run-ahead: enabled with %u frame(s), state size %u bytes", m_frameCount,
+      static_cast<unsigned int>(m_stateSize));
+}
+
+void CRunAhead::Deinitialize()
+{
+  m_client = nullptr;
+  m_frameCount = 0;
+  m_state.clear();
+  m_state.shrink_to_fit();
+  m_stateSize = 0;
+}
+
+void CRunAhead::RunFrame(bool bShowVideo)
+{
+  if (!IsEnabled())
+    return;
+
+  // Run normally until the core can save states
+  if (CLibretroEnvironment::Get().StateCapabilities().IsInitializing())
+  {
+    CCoreRunner::Run(*m_client, bShowVideo, true);
+    SaveState();
+    return;
+  }
+
+  // Advance the real state by one frame. Its audio is kept, but its video is
+  // replaced by the video of the last frame run ahead.
+  CCoreRunner::Run(*m_client, false, true);
+
+  if (!SaveState())
+    return;
+
+  for (unsigned int i = 1; i < m_frameCount; i++)
+    CCoreRunner::Run(*m_client, false, false);
+
+  CCoreRunner::Run(*m_client, bShowVideo, false);
+
+  LoadState();
+}
+
+bool CRunAhead::SaveState()
+{
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  m_stateSize = capabilities.SerializeSize(*m_client);
+  if (m_stateSize > m_state.size())
+    m_state.resize(m_stateSize);
+
+  if (!capabilities.Serialize(*m_client, m_state.data(), m_stateSize))
+  {
+    // Failures are expected until the core is initialized
+    if (capabilities.IsInitializing())
+      return false;
+
+    esyslog("Run-ahead: failed to save state, disabling");
+    Disable();
+    return false;
+  }
+
+  return true;
+}
+
+bool CRunAhead::LoadState()
+{
+  if (!m_client->retro_unserialize(m_state.data(), m_stateSize))
+  {
+    esyslog("Run-ahead: failed to restore state, disabling");
+    Disable();
+    return false;
+  }
+
+  return true;
+}
+
+void CRunAhead::Disable()
+{
+  m_frameCount = 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Input latency reduction by running the core ahead
+   *
+   * Every frame, the core is advanced by one frame and its state is saved.
+   * It is then run for N more frames with output suppressed except for the
+   * video of the last frame, which is shown. Finally the saved state is
+   * restored. This hides N frames of the game's internal input lag, at the
+   * cost of N + 1 emulated frames per displayed frame.
+   */
+  class CRunAhead
+  {
+  public:
+    CRunAhead() = default;
+
+    /*!
+     * \brief Prepare run-ahead for a loaded game
+     *
+     * \param client The libretro core
+     * \param frameCount The number of frames to run ahead, or 0 to disable
+     */
+    void Initialize(CLibretroDLL* client, unsigned int frameCount);
+    void Deinitialize();
+
+    bool IsEnabled() const { return m_client != nullptr && m_frameCount > 0; }
+
+    /*!
+     * \brief Emulate a frame, presenting the video of a frame N frames ahead
+     *
+     * If the core's state can't be saved or restored, run-ahead is disabled
+     * and following frames should be run normally.
+     *
+     * \param bShowVideo False to suppress the video of this frame entirely
+     */
+    void RunFrame(bool bShowVideo);
+
+  private:
+    bool SaveState();
+    bool LoadState();
+    void Disable();
+
+    CLibretroDLL* m_client = nullptr;
+    unsigned int m_frameCount = 0;
+    std::vector<uint8_t> m_state;
+    size_t m_stateSize = 0;
+  };
+}
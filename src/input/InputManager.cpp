@@ -450,6 +450,38 @@ bool CInputManager::AccelerometerState(unsigned int port, float& x, float& y, fl
   return bSuccess;
 }
 
+void CInputManager::GetInputSnapshot(std::vector<int32_t>& snapshot) const
+{
+  snapshot.clear();
+
+  // Each device is preceded by a marker so that connecting or disconnecting
+  // a device changes the snapshot even if the device has no input
+  if (m_keyboard)
+  {
+    snapshot.push_back(RETRO_DEVICE_KEYBOARD);
+    m_keyboard->Input().GetSnapshot(snapshot);
+  }
+
+  if (m_mouse)
+  {
+    snapshot.push_back(RETRO_DEVICE_MOUSE);
+    m_mouse->Input().GetSnapshot(snapshot);
+  }
+
+  for (const DevicePtr& controller : m_controllers)
+  {
+    if (controller)
+    {
+      snapshot.push_back(RETRO_DEVICE_JOYPAD);
+      controller->Input().GetSnapshot(snapshot);
+    }
+    else
+    {
+      snapshot.push_back(RETRO_DEVICE_NONE);
+    }
+  }
+}
+
 void CInputManager::SetControllerInfo(const retro_controller_info* info)
 {
   dsyslog("Libretro controller info:");
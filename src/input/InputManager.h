@@ -148,6 +148,16 @@ namespace LIBRETRO
     bool AbsolutePointerState(unsigned int port, unsigned int pointerIndex, float& x, float& y) const;
     bool AccelerometerState(unsigned int port, float& x, float& y, float& z) const;
 
+    /*!
+     * \brief Capture the state of the keyboard, mouse and every port
+     *
+     * Two snapshots are equal if the core would read the same input from
+     * them, which lets callers detect input changes between frames.
+     *
+     * \param[out] snapshot The snapshot, replacing any previous contents
+     */
+    void GetInputSnapshot(std::vector<int32_t>& snapshot) const;
+
     /*!
      * \brief Inform the frontend of controller info
      */
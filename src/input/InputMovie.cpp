@@ -0,0 +1,397 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "InputMovie.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "log/Log.h"
+
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define MOVIE_MAGIC          "KLRM"
+#define MOVIE_VERSION        1
+#define MOVIE_REPEAT_FRAME   0xffff // Value count marking a repeated frame
+#define MOVIE_MAX_VALUES     0xfffe
+#define MOVIE_FLUSH_SIZE     (64 * 1024) // Write recorded frames in chunks of this size
+
+#define FNV_OFFSET_BASIS     2166136261u
+#define FNV_PRIME            16777619u
+
+namespace
+{
+  void WriteU16(std::vector<uint8_t>& buffer, uint16_t value)
+  {
+    buffer.push_back(static_cast<uint8_t>(value));
+    buffer.push_back(static_cast<uint8_t>(value >> 8));
+  }
+
+  void WriteU32(std::vector<uint8_t>& buffer, uint32_t value)
+  {
+    WriteU16(buffer, static_cast<uint16_t>(value));
+    WriteU16(buffer, static_cast<uint16_t>(value >> 16));
+  }
+
+  void WriteU64(std::vector<uint8_t>& buffer, uint64_t value)
+  {
+    WriteU32(buffer, static_cast<uint32_t>(value));
+    WriteU32(buffer, static_cast<uint32_t>(value >> 32));
+  }
+
+  bool ReadU16(const std::vector<uint8_t>& buffer, size_t& position, uint16_t& value)
+  {
+    if (position + 2 > buffer.size())
+      return false;
+
+    value = static_cast<uint16_t>(buffer[position] | (buffer[position + 1] << 8));
+    position += 2;
+    return true;
+  }
+
+  bool ReadU32(const std::vector<uint8_t>& buffer, size_t& position, uint32_t& value)
+  {
+    uint16_t low;
+    uint16_t high;
+    if (!ReadU16(buffer, position, low) || !ReadU16(buffer, position, high))
+      return false;
+
+    value = low | (static_cast<uint32_t>(high) << 16);
+    return true;
+  }
+
+  bool ReadU64(const std::vector<uint8_t>& buffer, size_t& position, uint64_t& value)
+  {
+    uint32_t low;
+    uint32_t high;
+    if (!ReadU32(buffer, position, low) || !ReadU32(buffer, position, high))
+      return false;
+
+    value = low | (static_cast<uint64_t>(high) << 32);
+    return true;
+  }
+}
+
+CInputMovie& CInputMovie::Get()
+{
+  static CInputMovie _instance;
+  return _instance;
+}
+
+bool CInputMovie::StartRecording(const std::string& path, CLibretroDLL& client)
+{
+  Stop();
+
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  if (capabilities.IsIncomplete())
+  {
+    esyslog("Input movie: core's save states are incomplete, movies wouldn't play back reliably");
+    return false;
+  }
+
+  // A core that can't serialize yet is recorded from its current state,
+  // which is only reproducible if recording starts right after loading
+  std::vector<uint8_t> state(capabilities.SerializeSize(client));
+  if (!state.empty() && !capabilities.Serialize(client, state.data(), state.size()))
+  {
+    esyslog("Input movie: failed to save start state, recording from power-on");
+    state.clear();
+  }
+
+  if (!m_file.OpenFileForWrite(path, true))
+  {
+    esyslog("Input movie: failed to open %s for writing", path.c_str());
+    return false;
+  }
+
+  m_buffer.clear();
+  m_buffer.insert(m_buffer.end(), MOVIE_MAGIC, MOVIE_MAGIC + 4);
+  WriteU32(m_buffer, MOVIE_VERSION);
+  WriteU64(m_buffer, state.size());
+  m_buffer.insert(m_buffer.end(), state.begin(), state.end());
+
+  m_path = path;
+
+  if (!FlushRecording())
+  {
+    m_file.Close();
+    m_path.clear();
+    return false;
+  }
+
+  m_bRecording = true;
+
+  isyslog("Input movie: recording to %s (start state %u bytes)", m_path.c_str(),
+      static_cast<unsigned int>(state.size()));
+
+  return true;
+}
+
+bool CInputMovie::StartPlayback(const std::string& path, CLibretroDLL& client)
+{
+  Stop();
+
+  if (!m_file.OpenFile(path))
+  {
+    esyslog("Input movie: failed to open %s", path.c_str());
+    return false;
+  }
+
+  const int64_t length = m_file.GetLength();
+  m_buffer.resize(length > 0 ? static_cast<size_t>(length) : 0);
+
+  size_t bytesRead = 0;
+  while (bytesRead < m_buffer.size())
+  {
+    const ssize_t result = m_file.Read(m_buffer.data() + bytesRead, m_buffer.size() - bytesRead);
+    if (result <= 0)
+      break;
+    bytesRead += static_cast<size_t>(result);
+  }
+  m_file.Close();
+
+  m_readPosition = 0;
+
+  uint32_t version = 0;
+  uint64_t stateSize = 0;
+
+  if (bytesRead != m_buffer.size() || m_buffer.size() < 4 ||
+      memcmp(m_buffer.data(), MOVIE_MAGIC, 4) != 0)
+  {
+    esyslog("Input movie: %s is not a movie file", path.c_str());
+    m_buffer.clear();
+    return false;
+  }
+
+  m_readPosition = 4;
+
+  if (!ReadU32(m_buffer, m_readPosition, version) || version != MOVIE_VERSION ||
+      !ReadU64(m_buffer, m_readPosition, stateSize) || stateSize > m_buffer.size() - m_readPosition)
+  {
+    esyslog("Input movie: unsupported or corrupt movie file %s", path.c_str());
+    m_buffer.clear();
+    return false;
+  }
+
+  if (stateSize > 0)
+  {
+    if (CLibretroEnvironment::Get().StateCapabilities().IsSingleSession())
+    {
+      esyslog("Input movie: core can't load save states from an earlier session");
+      m_buffer.clear();
+      return false;
+    }
+
+    if (!client.retro_unserialize(m_buffer.data() + m_readPosition, static_cast<size_t>(stateSize)))
+    {
+      esyslog("Input movie: failed to restore start state");
+      m_buffer.clear();
+      return false;
+    }
+    m_readPosition += static_cast<size_t>(stateSize);
+  }
+
+  m_path = path;
+  m_bPlaying = true;
+
+  isyslog("Input movie: playing back %s", m_path.c_str());
+
+  return true;
+}
+
+void CInputMovie::Stop()
+{
+  // Ending the last frame stops recording if the movie can't be written
+  if (m_bRecording && m_bFrameStarted)
+    EndRecordedFrame();
+
+  if (m_bRecording)
+  {
+    const bool bFlushed = FlushRecording();
+    m_file.Close();
+
+    if (!bFlushed)
+      esyslog("Input movie: the last frames of %s are missing", m_path.c_str());
+
+    isyslog("Input movie: recorded %llu frames to %s",
+        static_cast<unsigned long long>(m_frameCount), m_path.c_str());
+  }
+  else if (m_bPlaying)
+  {
+    isyslog("Input movie: played back %llu frames from %s",
+        static_cast<unsigned long long>(m_frameCount), m_path.c_str());
+  }
+
+  m_path.clear();
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_readPosition = 0;
+  m_values.clear();
+  m_previousValues.clear();
+  m_queryHash = 0;
+  m_previousQueryHash = 0;
+  m_valueIndex = 0;
+  m_recordedQueryHash = 0;
+  m_bFrameStarted = false;
+  m_bRecording = false;
+  m_bPlaying = false;
+  m_bDesyncReported = false;
+  m_frameCount = 0;
+}
+
+void CInputMovie::OnFrameBegin()
+{
+  if (m_bRecording)
+  {
+    if (m_bFrameStarted)
+      EndRecordedFrame();
+
+    // Recording stops if the movie can't be written
+    if (m_bRecording)
+      m_bFrameStarted = true;
+  }
+  else if (m_bPlaying)
+  {
+    // The core must have made the same queries as when it was recorded
+    if (m_bFrameStarted && m_queryHash != m_recordedQueryHash && !m_bDesyncReported)
+    {
+      esyslog("Input movie: playback desynced at frame %llu, input queries differ from the recording",
+          static_cast<unsigned long long>(m_frameCount));
+      m_bDesyncReported = true;
+    }
+
+    if (!ReadPlaybackFrame())
+    {
+      Stop();
+      return;
+    }
+
+    m_bFrameStarted = true;
+  }
+
+  m_queryHash = FNV_OFFSET_BASIS;
+  m_valueIndex = 0;
+}
+
+void CInputMovie::RecordInput(unsigned int port, unsigned int device, unsigned int index, unsigned int id, int16_t value)
+{
+  if (!m_bRecording)
+    return;
+
+  m_queryHash = HashQuery(m_queryHash, port, device, index, id);
+  m_values.push_back(value);
+}
+
+int16_t CInputMovie::PlaybackInput(unsigned int port, unsigned int device, unsigned int index, unsigned int id)
+{
+  m_queryHash = HashQuery(m_queryHash, port, device, index, id);
+
+  if (m_valueIndex < m_values.size())
+    return m_values[m_valueIndex++];
+
+  return 0;
+}
+
+uint32_t CInputMovie::HashQuery(uint32_t hash, unsigned int port, unsigned int device, unsigned int index, unsigned int id)
+{
+  const uint32_t query[] = { port, device, index, id };
+
+  for (uint32_t word : query)
+  {
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      hash ^= (word >> (i * 8)) & 0xff;
+      hash *= FNV_PRIME;
+    }
+  }
+
+  return hash;
+}
+
+void CInputMovie::EndRecordedFrame()
+{
+  if (m_values.size() > MOVIE_MAX_VALUES)
+  {
+    esyslog("Input movie: frame %llu has too many input queries, truncating",
+        static_cast<unsigned long long>(m_frameCount));
+    m_values.resize(MOVIE_MAX_VALUES);
+  }
+
+  if (m_frameCount > 0 && m_queryHash == m_previousQueryHash && m_values == m_previousValues)
+  {
+    WriteU16(m_buffer, MOVIE_REPEAT_FRAME);
+  }
+  else
+  {
+    WriteU16(m_buffer, static_cast<uint16_t>(m_values.size()));
+    WriteU32(m_buffer, m_queryHash);
+    for (int16_t value : m_values)
+      WriteU16(m_buffer, static_cast<uint16_t>(value));
+  }
+
+  m_frameCount++;
+
+  std::swap(m_values, m_previousValues);
+  m_values.clear();
+  m_previousQueryHash = m_queryHash;
+
+  if (m_buffer.size() >= MOVIE_FLUSH_SIZE && !FlushRecording())
+  {
+    // A movie with missing frames would desync on playback
+    esyslog("Input movie: stopping recording after %llu frames, %s is incomplete",
+        static_cast<unsigned long long>(m_frameCount), m_path.c_str());
+    m_file.Close();
+    m_bRecording = false;
+    Stop();
+  }
+}
+
+bool CInputMovie::FlushRecording()
+{
+  if (m_buffer.empty())
+    return true;
+
+  const ssize_t written = m_file.Write(m_buffer.data(), m_buffer.size());
+  const bool bSuccess = written == static_cast<ssize_t>(m_buffer.size());
+  m_buffer.clear();
+
+  if (!bSuccess)
+  {
+    esyslog("Input movie: failed to write to %s", m_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool CInputMovie::ReadPlaybackFrame()
+{
+  uint16_t count;
+  if (!ReadU16(m_buffer, m_readPosition, count))
+    return false;
+
+  // A repeated frame keeps the values and hash of the previous frame
+  if (count != MOVIE_REPEAT_FRAME)
+  {
+    if (!ReadU32(m_buffer, m_readPosition, m_recordedQueryHash))
+      return false;
+
+    m_values.resize(count);
+    for (int16_t& value : m_values)
+    {
+      uint16_t rawValue;
+      if (!ReadU16(m_buffer, m_readPosition, rawValue))
+        return false;
+      value = static_cast<int16_t>(rawValue);
+    }
+  }
+
+  m_frameCount++;
+
+  return true;
+}
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/Filesystem.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Records the input read by the core, and plays it back
+   *
+   * A movie consists of the core's state when recording started, followed
+   * by every value returned from the input state callback, grouped by
+   * emulated frame. Playing it back restores the state and returns the
+   * recorded values instead of the user's input, which reproduces the
+   * session exactly as long as the core is deterministic.
+   *
+   * File format (little endian):
+   *
+   *   Header: "KLRM", version (u32), state size (u64), state
+   *   Frame:  value count (u16), hash of the queries (u32), values (s16)
+   *           or 0xffff if the frame is identical to the previous frame
+   *
+   * Frames are ended implicitly by the start of the next one.
+   */
+  class CInputMovie
+  {
+  private:
+    CInputMovie() = default;
+
+  public:
+    static CInputMovie& Get();
+
+    /*!
+     * \brief Start recording from the current state of the core
+     */
+    bool StartRecording(const std::string& path, CLibretroDLL& client);
+
+    /*!
+     * \brief Restore the start state of a movie and start playing it back
+     */
+    bool StartPlayback(const std::string& path, CLibretroDLL& client);
+
+    /*!
+     * \brief Finish recording or playback
+     */
+    void Stop();
+
+    bool IsRecording() const { return m_bRecording; }
+    bool IsPlaying() const { return m_bPlaying; }
+
+    /*!
+     * \brief Called before the core runs a frame
+     */
+    void OnFrameBegin();
+
+    /*!
+     * \brief Record the value returned to the core for an input query
+     */
+    void RecordInput(unsigned int port, unsigned int device, unsigned int index, unsigned int id, int16_t value);
+
+    /*!
+     * \brief Get the recorded value for the next input query
+     */
+    int16_t PlaybackInput(unsigned int port, unsigned int device, unsigned int index, unsigned int id);
+
+  private:
+    static uint32_t HashQuery(uint32_t hash, unsigned int port, unsigned int device, unsigned int index, unsigned int id);
+
+    // Recording
+    void EndRecordedFrame();
+    bool FlushRecording();
+
+    // Playback
+    bool ReadPlaybackFrame();
+
+    // Movie file
+    std::string m_path;
+    kodi::vfs::CFile m_file;
+    std::vector<uint8_t> m_buffer; // Unwritten data when recording, whole movie when playing
+    size_t m_readPosition = 0;
+
+    // Current frame
+    std::vector<int16_t> m_values;
+    std::vector<int16_t> m_previousValues;
+    uint32_t m_queryHash = 0;
+    uint32_t m_previousQueryHash = 0;
+    size_t m_valueIndex = 0;
+    uint32_t m_recordedQueryHash = 0;
+    bool m_bFrameStarted = false;
+
+    // State
+    bool m_bRecording = false;
+    bool m_bPlaying = false;
+    bool m_bDesyncReported = false;
+    uint64_t m_frameCount = 0;
+  };
+}
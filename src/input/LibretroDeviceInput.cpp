@@ -162,6 +162,55 @@ bool CLibretroDeviceInput::AbsolutePointerState(unsigned int pointerIndex, float
   return bSuccess;
 }
 
+void CLibretroDeviceInput::GetSnapshot(std::vector<int32_t>& snapshot) const
+{
+  // Pack digital buttons 32 to a word
+  for (size_t i = 0; i < m_buttons.size(); i += 32)
+  {
+    uint32_t word = 0;
+    for (size_t bit = 0; bit < 32 && i + bit < m_buttons.size(); bit++)
+    {
+      if (m_buttons[i + bit].pressed)
+        word |= 1u << bit;
+    }
+    snapshot.push_back(static_cast<int32_t>(word));
+  }
+
+  for (const auto& analogButton : m_analogButtons)
+    snapshot.push_back(static_cast<int32_t>(analogButton.magnitude * 0x7fff));
+
+  for (const auto& analogStick : m_analogSticks)
+  {
+    snapshot.push_back(static_cast<int32_t>(analogStick.x * 0x7fff));
+    snapshot.push_back(static_cast<int32_t>(analogStick.y * 0x7fff));
+  }
+
+  for (const auto& accelerometer : m_accelerometers)
+  {
+    snapshot.push_back(static_cast<int32_t>(accelerometer.x * 0x7fff));
+    snapshot.push_back(static_cast<int32_t>(accelerometer.y * 0x7fff));
+    snapshot.push_back(static_cast<int32_t>(accelerometer.z * 0x7fff));
+  }
+
+  if (!m_relativePointers.empty())
+  {
+    std::unique_lock<std::mutex> lock(m_relativePtrMutex);
+
+    for (const auto& relativePointer : m_relativePointers)
+    {
+      snapshot.push_back(relativePointer.x);
+      snapshot.push_back(relativePointer.y);
+    }
+  }
+
+  for (const auto& absolutePointer : m_absolutePointers)
+  {
+    snapshot.push_back(absolutePointer.pressed ? 1 : 0);
+    snapshot.push_back(static_cast<int32_t>(absolutePointer.x * 0x7fff));
+    snapshot.push_back(static_cast<int32_t>(absolutePointer.y * 0x7fff));
+  }
+}
+
 bool CLibretroDeviceInput::InputEvent(const game_input_event& event)
 {
   const std::string strControllerId = event.controller_id ? event.controller_id : "";
@@ -10,6 +10,7 @@
 #include <kodi/addon-instance/Game.h>
 #include <mutex>
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -30,6 +31,15 @@ namespace LIBRETRO
     int   RelativePointerDeltaY(void);
     bool  AbsolutePointerState(unsigned int pointerIndex, float& x, float& y) const;
 
+    /*!
+     * \brief Append the state of all features to an input snapshot
+     *
+     * Analog values are quantized to the resolution reported to the core, so
+     * two snapshots compare equal if the core would see the same input.
+     * Pending relative pointer motion is included without being consumed.
+     */
+    void GetSnapshot(std::vector<int32_t>& snapshot) const;
+
     bool InputEvent(const game_input_event& event);
 
   private:
@@ -47,6 +57,6 @@ namespace LIBRETRO
     std::vector<game_accelerometer_event>  m_accelerometers;
     std::vector<game_rel_pointer_event>    m_relativePointers;
     std::vector<game_abs_pointer_event>    m_absolutePointers;
-    std::mutex                             m_relativePtrMutex;
+    mutable std::mutex                     m_relativePtrMutex;
   };
 }
@@ -24,7 +24,8 @@ CClientBridge::CClientBridge()
     m_retro_hw_context_destroy(nullptr),
     m_retro_audio_set_state_callback(nullptr),
     m_retro_audio_callback(nullptr),
-    m_retro_frame_time_callback(nullptr)
+    m_retro_frame_time_callback(nullptr),
+    m_frameTimeReference(0)
 {
 }
 
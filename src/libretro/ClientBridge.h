@@ -51,6 +51,13 @@ namespace LIBRETRO
     void SetAudioAvailable(AudioAvailableCallback callback)     { m_retro_audio_callback = callback; }
     void SetFrameTime(FrameTimeCallback callback)               { m_retro_frame_time_callback = callback; }
 
+    /*!
+     * \brief The ideal frame time in microseconds reported along with the
+     *        frame time callback, or 0 if the core didn't register one
+     */
+    void SetFrameTimeReference(retro_usec_t reference) { m_frameTimeReference = reference; }
+    retro_usec_t FrameTimeReference() const { return m_frameTimeReference; }
+
   private:
     // The bridge is accomplished by invoking the callback provided by libretro's
     // enironment callback. The frontend can only invoke the commands above
@@ -61,5 +68,6 @@ namespace LIBRETRO
     AudioEnableCallback      m_retro_audio_set_state_callback;
     AudioAvailableCallback   m_retro_audio_callback;
     FrameTimeCallback        m_retro_frame_time_callback;
+    retro_usec_t             m_frameTimeReference;
   };
 } // namespace LIBRETRO
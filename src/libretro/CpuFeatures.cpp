@@ -0,0 +1,202 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "CpuFeatures.h"
+#include "libretro-common/libretro.h"
+#include "log/Log.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #include <intrin.h>
+  #define CPU_X86
+#elif defined(__i386__) || defined(__x86_64__)
+  #include <cpuid.h>
+  #define CPU_X86
+#elif defined(__arm__) && defined(__linux__)
+  #include <sys/auxv.h>
+#endif
+
+using namespace LIBRETRO;
+
+namespace
+{
+#if defined(CPU_X86)
+  struct CpuidRegisters
+  {
+    uint32_t eax = 0;
+    uint32_t ebx = 0;
+    uint32_t ecx = 0;
+    uint32_t edx = 0;
+  };
+
+  CpuidRegisters Cpuid(uint32_t leaf, uint32_t subleaf = 0)
+  {
+    CpuidRegisters regs;
+#if defined(_MSC_VER)
+    int info[4] = { };
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    regs.eax = info[0];
+    regs.ebx = info[1];
+    regs.ecx = info[2];
+    regs.edx = info[3];
+#else
+    __cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+#endif
+    return regs;
+  }
+
+  // Query which register states the OS saves on context switches
+  uint64_t Xgetbv()
+  {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax;
+    uint32_t edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+  }
+
+  constexpr uint64_t XCR0_SSE_AVX = 0x06; // XMM and YMM state
+  constexpr uint64_t XCR0_AVX512 = 0xe0; // Opmask and ZMM state
+#endif
+
+#if defined(__arm__) && defined(__linux__)
+  // From <asm/hwcap.h>, which isn't available on all toolchains
+  constexpr unsigned long ARM_HWCAP_NEON = 1 << 12;
+  constexpr unsigned long ARM_HWCAP_VFPv3 = 1 << 13;
+  constexpr unsigned long ARM_HWCAP_VFPv4 = 1 << 16;
+#endif
+}
+
+CCpuFeatures& CCpuFeatures::Get()
+{
+  static CCpuFeatures _instance;
+  return _instance;
+}
+
+void CCpuFeatures::Detect()
+{
+  uint64_t features = 0;
+  m_bAVX512 = false;
+
+#if defined(CPU_X86)
+  const uint32_t maxLeaf = Cpuid(0).eax;
+  const uint32_t maxExtendedLeaf = Cpuid(0x80000000).eax;
+
+  if (maxLeaf >= 1)
+  {
+    const CpuidRegisters leaf1 = Cpuid(1);
+
+    if (leaf1.edx & (1 << 15)) features |= RETRO_SIMD_CMOV;
+    if (leaf1.edx & (1 << 23)) features |= RETRO_SIMD_MMX;
+    if (leaf1.edx & (1 << 25)) features |= RETRO_SIMD_SSE | RETRO_SIMD_MMXEXT; // SSE implies MMXEXT
+    if (leaf1.edx & (1 << 26)) features |= RETRO_SIMD_SSE2;
+    if (leaf1.ecx & (1 << 0))  features |= RETRO_SIMD_SSE3;
+    if (leaf1.ecx & (1 << 9))  features |= RETRO_SIMD_SSSE3;
+    if (leaf1.ecx & (1 << 19)) features |= RETRO_SIMD_SSE4;
+    if (leaf1.ecx & (1 << 20)) features |= RETRO_SIMD_SSE42;
+    if (leaf1.ecx & (1 << 22)) features |= RETRO_SIMD_MOVBE;
+    if (leaf1.ecx & (1 << 23)) features |= RETRO_SIMD_POPCNT;
+    if (leaf1.ecx & (1 << 25)) features |= RETRO_SIMD_AES;
+
+    // AVX also needs the OS to save YMM registers
+    const bool bOSXSAVE = (leaf1.ecx & (1 << 27)) != 0;
+    const uint64_t xcr0 = bOSXSAVE ? Xgetbv() : 0;
+    const bool bAVX = (leaf1.ecx & (1 << 28)) && (xcr0 & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+
+    if (bAVX)
+    {
+      features |= RETRO_SIMD_AVX;
+
+      if (maxLeaf >= 7)
+      {
+        const CpuidRegisters leaf7 = Cpuid(7, 0);
+
+        if (leaf7.ebx & (1 << 5))
+          features |= RETRO_SIMD_AVX2;
+
+        if ((leaf7.ebx & (1 << 16)) && (xcr0 & XCR0_AVX512) == XCR0_AVX512)
+          m_bAVX512 = true;
+      }
+    }
+  }
+
+  // AMD reports MMXEXT separately for CPUs without SSE
+  if (maxExtendedLeaf >= 0x80000001)
+  {
+    if (Cpuid(0x80000001).edx & (1 << 22))
+      features |= RETRO_SIMD_MMXEXT;
+  }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  // Advanced SIMD is mandatory on ARMv8-A
+  features |= RETRO_SIMD_NEON | RETRO_SIMD_ASIMD;
+#elif defined(__arm__) && defined(__linux__)
+  const unsigned long hwcap = getauxval(AT_HWCAP);
+
+  if (hwcap & ARM_HWCAP_NEON)  features |= RETRO_SIMD_NEON;
+  if (hwcap & ARM_HWCAP_VFPv3) features |= RETRO_SIMD_VFPV3;
+  if (hwcap & ARM_HWCAP_VFPv4) features |= RETRO_SIMD_VFPV4;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  // No runtime detection available, trust the compiler
+  features |= RETRO_SIMD_NEON;
+#endif
+
+  m_features = features;
+
+  dsyslog("CPU features: %s%s", FeaturesToString(m_features).c_str(),
+      m_bAVX512 ? " (AVX-512F also available)" : "");
+}
+
+std::string CCpuFeatures::FeaturesToString(uint64_t features)
+{
+  static const struct
+  {
+    uint64_t flag;
+    const char* name;
+  } featureNames[] = {
+    { RETRO_SIMD_MMX, "MMX" },
+    { RETRO_SIMD_MMXEXT, "MMXEXT" },
+    { RETRO_SIMD_SSE, "SSE" },
+    { RETRO_SIMD_SSE2, "SSE2" },
+    { RETRO_SIMD_SSE3, "SSE3" },
+    { RETRO_SIMD_SSSE3, "SSSE3" },
+    { RETRO_SIMD_SSE4, "SSE4.1" },
+    { RETRO_SIMD_SSE42, "SSE4.2" },
+    { RETRO_SIMD_AVX, "AVX" },
+    { RETRO_SIMD_AVX2, "AVX2" },
+    { RETRO_SIMD_AES, "AES" },
+    { RETRO_SIMD_POPCNT, "POPCNT" },
+    { RETRO_SIMD_MOVBE, "MOVBE" },
+    { RETRO_SIMD_CMOV, "CMOV" },
+    { RETRO_SIMD_VMX, "VMX" },
+    { RETRO_SIMD_VMX128, "VMX128" },
+    { RETRO_SIMD_NEON, "NEON" },
+    { RETRO_SIMD_ASIMD, "ASIMD" },
+    { RETRO_SIMD_VFPV3, "VFPv3" },
+    { RETRO_SIMD_VFPV4, "VFPv4" },
+    { RETRO_SIMD_VFPU, "VFPU" },
+    { RETRO_SIMD_PS, "PS" },
+  };
+
+  std::string result;
+
+  for (const auto& feature : featureNames)
+  {
+    if (features & feature.flag)
+    {
+      if (!result.empty())
+        result += " ";
+      result += feature.name;
+    }
+  }
+
+  if (result.empty())
+    result = "none";
+
+  return result;
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Runtime detection of the SIMD extensions supported by the CPU
+   *
+   * Features are reported as a bitmask of RETRO_SIMD_* flags, which is what
+   * cores receive from get_cpu_features() in the perf interface.
+   */
+  class CCpuFeatures
+  {
+  private:
+    CCpuFeatures() = default;
+
+  public:
+    static CCpuFeatures& Get();
+
+    /*!
+     * \brief Query the CPU and cache the result
+     */
+    void Detect();
+
+    /*!
+     * \brief Get the detected features as a bitmask of RETRO_SIMD_* flags
+     */
+    uint64_t Features() const { return m_features; }
+
+    bool Has(uint64_t feature) const { return (m_features & feature) == feature; }
+
+    /*!
+     * \brief True if AVX-512 Foundation is usable
+     *
+     * There is no RETRO_SIMD_* flag for AVX-512, so this is only available
+     * to the add-on.
+     */
+    bool HasAVX512() const { return m_bAVX512; }
+
+    static std::string FeaturesToString(uint64_t features);
+
+  private:
+    uint64_t m_features = 0;
+    bool m_bAVX512 = false;
+  };
+}
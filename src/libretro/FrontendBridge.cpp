@@ -6,10 +6,14 @@
  */
 
 #include "FrontendBridge.h"
+#include "CpuFeatures.h"
 #include "LibretroEnvironment.h"
 #include "LibretroTranslator.h"
+#include "PerfCounters.h"
 #include "input/ButtonMapper.h"
 #include "input/InputManager.h"
+#include "input/InputMovie.h"
+#include "utils/FrameProfiler.h"
 #include "client.h"
 
 #include <algorithm>
@@ -65,9 +69,9 @@ void CFrontendBridge::VideoRefresh(const void* data, unsigned int width, unsigne
   else
   {
     CLibretroEnvironment::Get().Video().AddFrame(static_cast<const uint8_t*>(data),
-                                                 static_cast<unsigned int>(pitch * height),
                                                  width,
                                                  height,
+                                                 pitch,
                                                  CLibretroEnvironment::Get().GetVideoFormat(),
                                                  CLibretroEnvironment::Get().GetVideoRotation());
   }
@@ -93,11 +97,16 @@ void CFrontendBridge::InputPoll(void)
 
 int16_t CFrontendBridge::InputState(unsigned int port, unsigned int device, unsigned int index, unsigned int id)
 {
+  CFrameTimer inputTimer(FRAME_PHASE_INPUT);
+
   int16_t inputState = 0;
 
   // According to libretro.h, device should already be masked, but just in case
   device &= RETRO_DEVICE_MASK;
 
+  if (CInputMovie::Get().IsPlaying())
+    return CInputMovie::Get().PlaybackInput(port, device, index, id);
+
   switch (device)
   {
   case RETRO_DEVICE_JOYPAD:
@@ -181,6 +190,9 @@ int16_t CFrontendBridge::InputState(unsigned int port, unsigned int device, unsi
     break;
   }
 
+  if (CInputMovie::Get().IsRecording())
+    CInputMovie::Get().RecordInput(port, device, index, id, inputState);
+
   return inputState;
 }
 
@@ -282,37 +294,37 @@ void CFrontendBridge::StopCamera(void)
 
 retro_time_t CFrontendBridge::PerfGetTimeUsec(void)
 {
-  return 0; // Not implemented
+  return CPerfCounters::GetTimeUsec();
 }
 
 retro_perf_tick_t CFrontendBridge::PerfGetCounter(void)
 {
-  return 0; // Not implemented
+  return CPerfCounters::GetCounter();
 }
 
 uint64_t CFrontendBridge::PerfGetCpuFeatures(void)
 {
-  return 0; // Not implemented
+  return CCpuFeatures::Get().Features();
 }
 
 void CFrontendBridge::PerfLog(void)
 {
-  // Not implemented
+  CPerfCounters::Get().Log();
 }
 
 void CFrontendBridge::PerfRegister(retro_perf_counter *counter)
 {
-  // Not implemented
+  CPerfCounters::Get().Register(counter);
 }
 
 void CFrontendBridge::PerfStart(retro_perf_counter *counter)
 {
-  // Not implemented
+  CPerfCounters::Start(counter);
 }
 
 void CFrontendBridge::PerfStop(retro_perf_counter *counter)
 {
-  // Not implemented
+  CPerfCounters::Stop(counter);
 }
 
 bool CFrontendBridge::StartLocation(void)
@@ -8,8 +8,6 @@
 #include "LibretroDLL.h"
 #include "log/Log.h"
 
-#include <kodi/addon-instance/Game.h>
-
 #include <dlfcn.h>
 
 #include <assert.h>
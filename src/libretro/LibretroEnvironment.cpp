@@ -11,9 +11,10 @@
 #include "libretro-common/libretro.h"
 #include "LibretroDLL.h"
 #include "LibretroTranslator.h"
+#include "capture/InstantReplay.h"
+#include "capture/MediaCapture.h"
 #include "input/InputManager.h"
 #include "log/Log.h"
-#include "settings/Settings.h"
 #include "video/VideoGeometry.h"
 #include "client.h"
 
@@ -34,7 +35,10 @@ CLibretroEnvironment::CLibretroEnvironment(void) :
   m_client(nullptr),
   m_clientBridge(nullptr),
   m_videoFormat(GAME_PIXEL_FORMAT_0RGB1555), // Default libretro format
-  m_videoRotation(GAME_VIDEO_ROTATION_0)
+  m_videoRotation(GAME_VIDEO_ROTATION_0),
+  m_bFastForwarding(false),
+  m_frameRate(0.0),
+  m_sampleRate(0.0)
 {
 }
 
@@ -55,6 +59,8 @@ void CLibretroEnvironment::InitializeEnvironment(CGameLibRetro* addon,
   m_videoStream.Initialize(m_addon);
   m_audioStream.Initialize(m_addon);
 
+  m_stateCapabilities.Reset();
+
   m_settings.Initialize(m_addon);
   m_resources.Initialize(m_addon);
 
@@ -86,12 +92,26 @@ void CLibretroEnvironment::CloseStreams()
   m_audioStream.Deinitialize();
 }
 
+void CLibretroEnvironment::SetAudioVideoEnabled(bool bVideo, bool bAudio)
+{
+  m_videoStream.SetEnabled(bVideo);
+  m_audioStream.SetEnabled(bAudio);
+}
+
 void CLibretroEnvironment::UpdateVideoGeometry(const retro_game_geometry &geometry)
 {
   CVideoGeometry videoGeometry(geometry);
   m_videoStream.SetGeometry(videoGeometry);
 }
 
+void CLibretroEnvironment::UpdateTiming(const retro_system_timing &timing)
+{
+  m_frameRate = timing.fps;
+  m_sampleRate = timing.sample_rate;
+
+  m_audioStream.SetTiming(m_sampleRate, m_frameRate);
+}
+
 void CLibretroEnvironment::SetSetting(const std::string& name, const std::string& value)
 {
   m_settings.SetCurrentValue(name, value);
@@ -105,6 +125,7 @@ std::string CLibretroEnvironment::GetResourcePath(const char* relPath)
 void CLibretroEnvironment::OnFrameEnd()
 {
   m_videoStream.OnFrameEnd();
+  m_audioStream.OnFrameEnd();
 }
 
 bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
@@ -124,8 +145,9 @@ bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
   case RETRO_ENVIRONMENT_GET_OVERSCAN:
     {
       bool* typedData = reinterpret_cast<bool*>(data);
+      // Overscan is cropped by the add-on, so cores should always output it
       if (typedData)
-        *typedData = !CSettings::Get().CropOverscan();
+        *typedData = true;
       break;
     }
   case RETRO_ENVIRONMENT_GET_CAN_DUPE:
@@ -306,7 +328,7 @@ bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
       {
         // Store callbacks from libretro client.
         m_clientBridge->SetFrameTime(typedData->callback);
-        return false;
+        m_clientBridge->SetFrameTimeReference(typedData->reference);
       }
       break;
     }
@@ -416,11 +438,12 @@ bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
       CVideoGeometry videoGeometry(typedData->geometry);
       m_videoStream.SetGeometry(videoGeometry);
 
-      //! @todo Reopen streams if geometry changes
-
       //! @todo Report updating timing info to frontend
-      const double fps = typedData->timing.fps;
-      const double sampleRate = typedData->timing.sample_rate;
+      UpdateTiming(typedData->timing);
+
+      // The capture files give their rate in the header
+      CMediaCapture::Get().SetTiming(m_frameRate, m_sampleRate);
+      CInstantReplay::Get().SetTiming(m_frameRate, m_sampleRate);
 
       break;
     }
@@ -464,11 +487,17 @@ bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
   case RETRO_ENVIRONMENT_SET_GEOMETRY:
   {
     const retro_game_geometry* typedData = reinterpret_cast<const retro_game_geometry*>(data);
-    if (typedData)
-    {
-      // Not implemented
+    if (!typedData)
       return false;
-    }
+
+    // Only the base size and aspect ratio may change, the maximum size
+    // requires RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO
+    retro_game_geometry geometry = *typedData;
+    geometry.max_width = m_videoStream.Geometry().MaxWidth();
+    geometry.max_height = m_videoStream.Geometry().MaxHeight();
+
+    UpdateVideoGeometry(geometry);
+
     break;
   }
   case RETRO_ENVIRONMENT_GET_USERNAME:
@@ -601,14 +630,37 @@ bool CLibretroEnvironment::EnvironmentCallback(unsigned int cmd, void *data)
   }
   case RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS:
   {
-    const retro_hw_render_context_negotiation_interface* typedData = reinterpret_cast<const retro_hw_render_context_negotiation_interface*>(data);
+    uint64_t* typedData = reinterpret_cast<uint64_t*>(data);
     if (typedData)
     {
-      // Not implemented
-      return false;
+      // Report back which quirks are understood
+      *typedData = m_stateCapabilities.SetQuirks(*typedData);
+    }
+    break;
+  }
+  case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
+  {
+    int* typedData = reinterpret_cast<int*>(data);
+    if (typedData)
+    {
+      // Bit 0: Render video, bit 1: Render audio
+      int result = 0;
+      if (m_videoStream.IsEnabled())
+        result |= 1 << 0;
+      if (m_audioStream.IsEnabled())
+        result |= 1 << 1;
+
+      *typedData = result;
     }
     break;
   }
+  case RETRO_ENVIRONMENT_GET_FASTFORWARDING:
+  {
+    bool* typedData = reinterpret_cast<bool*>(data);
+    if (typedData)
+      *typedData = m_bFastForwarding;
+    break;
+  }
   default:
     return false;
   }
@@ -10,6 +10,7 @@
 #include "LibretroResources.h"
 #include "audio/AudioStream.h"
 #include "MemoryMap.h"
+#include "savestate/StateCapabilities.h"
 #include "settings/LibretroSettings.h"
 #include "video/VideoStream.h"
 
@@ -21,6 +22,7 @@
 class CGameLibRetro;
 
 struct retro_game_geometry;
+struct retro_system_timing;
 
 namespace LIBRETRO
 {
@@ -46,10 +48,41 @@ namespace LIBRETRO
     CVideoStream& Video(void) { return m_videoStream; }
     CAudioStream& Audio(void) { return m_audioStream; }
 
+    /*!
+     * \brief What the core's save states can be used for
+     */
+    CStateCapabilities& StateCapabilities(void) { return m_stateCapabilities; }
+
     void CloseStreams();
 
+    /*!
+     * \brief Enable or disable audio and video output for the next frames
+     */
+    void SetAudioVideoEnabled(bool bVideo, bool bAudio);
+
+    /*!
+     * \brief Report to the core whether the frontend is fast-forwarding
+     */
+    void SetFastForwarding(bool bFastForwarding) { m_bFastForwarding = bFastForwarding; }
+    bool IsFastForwarding() const { return m_bFastForwarding; }
+
     void UpdateVideoGeometry(const retro_game_geometry &geometry);
 
+    /*!
+     * \brief Record the timing reported by the core
+     */
+    void UpdateTiming(const retro_system_timing &timing);
+
+    /*!
+     * \brief Frame rate of the core, or 0.0 if unknown
+     */
+    double GetFrameRate() const { return m_frameRate; }
+
+    /*!
+     * \brief Audio sample rate of the core, or 0.0 if unknown
+     */
+    double GetSampleRate() const { return m_sampleRate; }
+
     /*!
      * Returns the pixel format set by the libretro core. Instead of forwarding
      * this to the frontend, we store the value and report it on calls to
@@ -66,6 +99,11 @@ namespace LIBRETRO
 
     std::string GetResourcePath(const char* relPath);
 
+    /*!
+     * \brief Directory where the core and the add-on store save data
+     */
+    std::string GetSaveDirectory() const { return m_resources.GetSaveDirectory(); }
+
     /*!
      * \brief Called after game has been run for a frame
      */
@@ -83,9 +121,13 @@ namespace LIBRETRO
     CClientBridge* m_clientBridge;
     CVideoStream m_videoStream;
     CAudioStream m_audioStream;
+    CStateCapabilities m_stateCapabilities;
 
     GAME_PIXEL_FORMAT m_videoFormat;
     GAME_VIDEO_ROTATION m_videoRotation;
+    bool m_bFastForwarding;
+    double m_frameRate;
+    double m_sampleRate;
 
     CLibretroSettings m_settings;
     CLibretroResources m_resources;
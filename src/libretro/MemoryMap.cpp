@@ -12,7 +12,7 @@ using namespace LIBRETRO;
 void CMemoryMap::Initialize(const retro_memory_map& mmap)
 {
   for (unsigned int i = 0; i < mmap.num_descriptors; i++)
-    m_mmap.push_back({mmap.descriptors[i], 0});
+    m_mmap.push_back({mmap.descriptors[i], 0, mmap.descriptors[i].len});
 
   PreprocessDescriptors();
 }
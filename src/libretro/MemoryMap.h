@@ -14,6 +14,7 @@ struct retro_memory_descriptor_kodi
 {
   retro_memory_descriptor descriptor;
   size_t disconnectMask;
+  size_t reportedLength; // Length given by the core, or 0 if it was inferred from select
 };
 
 namespace LIBRETRO
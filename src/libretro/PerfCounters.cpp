@@ -0,0 +1,140 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "PerfCounters.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #include <intrin.h>
+  #define HAS_RDTSC
+#elif defined(__i386__) || defined(__x86_64__)
+  #include <x86intrin.h>
+  #define HAS_RDTSC
+#endif
+
+using namespace LIBRETRO;
+
+#define CALIBRATION_MIN_USEC  100000 // Need 100ms of samples to convert ticks to time
+
+CPerfCounters::CPerfCounters() :
+  m_startTicks(GetCounter()),
+  m_startUsec(GetTimeUsec())
+{
+}
+
+CPerfCounters& CPerfCounters::Get()
+{
+  static CPerfCounters _instance;
+  return _instance;
+}
+
+retro_time_t CPerfCounters::GetTimeUsec()
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+retro_perf_tick_t CPerfCounters::GetCounter()
+{
+#if defined(HAS_RDTSC)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+#endif
+}
+
+void CPerfCounters::Register(retro_perf_counter* counter)
+{
+  if (counter == nullptr || counter->registered)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_counters.push_back(counter);
+  counter->registered = true;
+}
+
+void CPerfCounters::Start(retro_perf_counter* counter)
+{
+  if (counter == nullptr)
+    return;
+
+  counter->call_cnt++;
+  counter->start = GetCounter();
+}
+
+void CPerfCounters::Stop(retro_perf_counter* counter)
+{
+  if (counter == nullptr)
+    return;
+
+  counter->total += GetCounter() - counter->start;
+}
+
+void CPerfCounters::Log()
+{
+  std::vector<retro_perf_counter*> counters;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    counters = m_counters;
+  }
+
+  if (counters.empty())
+    return;
+
+  std::sort(counters.begin(), counters.end(),
+    [](const retro_perf_counter* lhs, const retro_perf_counter* rhs)
+    {
+      return lhs->total > rhs->total;
+    });
+
+  const double ticksPerUsec = TicksPerUsec();
+
+  isyslog("Performance counters (%u registered):", static_cast<unsigned int>(counters.size()));
+
+  for (const retro_perf_counter* counter : counters)
+  {
+    const char* ident = counter->ident != nullptr ? counter->ident : "";
+    const unsigned long long calls = counter->call_cnt;
+    const unsigned long long total = counter->total;
+    const double average = calls > 0 ? static_cast<double>(total) / calls : 0.0;
+
+    if (ticksPerUsec > 0.0)
+    {
+      isyslog("  %-24s calls: %10llu  total: %12.0f us  avg: %10.3f us",
+          ident, calls, total / ticksPerUsec, average / ticksPerUsec);
+    }
+    else
+    {
+      isyslog("  %-24s calls: %10llu  total: %14llu ticks  avg: %12.1f ticks",
+          ident, calls, total, average);
+    }
+  }
+}
+
+void CPerfCounters::Clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_counters.clear();
+}
+
+double CPerfCounters::TicksPerUsec() const
+{
+  const retro_time_t elapsedUsec = GetTimeUsec() - m_startUsec;
+  if (elapsedUsec < CALIBRATION_MIN_USEC)
+    return 0.0;
+
+  return static_cast<double>(GetCounter() - m_startTicks) / elapsedUsec;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "libretro-common/libretro.h"
+
+#include <mutex>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Backend for the libretro performance interface
+   *
+   * Counters are owned by the core. They are registered here so that their
+   * totals can be summarized in the log. Starting and stopping a counter only
+   * reads the tick counter and touches the counter itself, so it is cheap
+   * enough to leave enabled in production.
+   */
+  class CPerfCounters
+  {
+  private:
+    CPerfCounters();
+
+  public:
+    static CPerfCounters& Get();
+
+    /*!
+     * \brief Get a monotonic time in microseconds
+     */
+    static retro_time_t GetTimeUsec();
+
+    /*!
+     * \brief Get the current value of the CPU's tick counter
+     *
+     * This is the TSC on x86, the virtual counter on ARM64 and a monotonic
+     * clock in nanoseconds elsewhere.
+     */
+    static retro_perf_tick_t GetCounter();
+
+    void Register(retro_perf_counter* counter);
+
+    static void Start(retro_perf_counter* counter);
+    static void Stop(retro_perf_counter* counter);
+
+    /*!
+     * \brief Log all registered counters, sorted by total time
+     */
+    void Log();
+
+    /*!
+     * \brief Forget all registered counters
+     *
+     * Must be called before the core is unloaded, as the counters live in
+     * the core's memory.
+     */
+    void Clear();
+
+  private:
+    double TicksPerUsec() const;
+
+    std::vector<retro_perf_counter*> m_counters;
+    std::mutex m_mutex;
+
+    // Calibration of the tick counter against the monotonic clock
+    const retro_perf_tick_t m_startTicks;
+    const retro_time_t m_startUsec;
+  };
+}
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "DeltaCodec.h"
+
+#include <string.h>
+
+using namespace LIBRETRO;
+
+// Runs of fewer zeros than this are cheaper to store as literals
+#define MIN_ZERO_RUN  4
+
+namespace
+{
+  void WriteVarint(std::vector<uint8_t>& buffer, size_t value)
+  {
+    while (value >= 0x80)
+    {
+      buffer.push_back(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+  }
+
+  bool ReadVarint(const uint8_t* data, size_t size, size_t& position, size_t& value)
+  {
+    value = 0;
+
+    for (unsigned int shift = 0; shift < sizeof(size_t) * 8; shift += 7)
+    {
+      if (position >= size)
+        return false;
+
+      const uint8_t byte = data[position++];
+      value |= static_cast<size_t>(byte & 0x7f) << shift;
+
+      if ((byte & 0x80) == 0)
+        return true;
+    }
+
+    return false;
+  }
+
+  // Previous data, or zero if there is none
+  inline uint8_t PreviousByte(const uint8_t* previous, size_t offset)
+  {
+    return previous != nullptr ? previous[offset] : 0;
+  }
+
+  // Length of the run of identical bytes starting at offset
+  size_t EqualRun(const uint8_t* a, const uint8_t* b, size_t offset, size_t size)
+  {
+    size_t i = offset;
+
+    // Compare a word at a time, most of the state is unchanged
+    while (i + sizeof(uint64_t) <= size)
+    {
+      uint64_t wordA;
+      uint64_t wordB = 0;
+      memcpy(&wordA, a + i, sizeof(wordA));
+      if (b != nullptr)
+        memcpy(&wordB, b + i, sizeof(wordB));
+      if (wordA != wordB)
+        break;
+      i += sizeof(uint64_t);
+    }
+
+    while (i < size && a[i] == PreviousByte(b, i))
+      i++;
+
+    return i - offset;
+  }
+}
+
+void CDeltaCodec::Encode(const uint8_t* current, const uint8_t* previous, size_t size, std::vector<uint8_t>& encoded)
+{
+  encoded.clear();
+
+  size_t position = 0;
+  while (position < size)
+  {
+    const size_t zeros = EqualRun(current, previous, position, size);
+    position += zeros;
+
+    if (position >= size)
+      break; // Trailing zeros are implicit
+
+    // Extend the literal run until the next run of zeros worth encoding
+    size_t literalEnd = position;
+    while (literalEnd < size)
+    {
+      if (current[literalEnd] != PreviousByte(previous, literalEnd))
+      {
+        literalEnd++;
+        continue;
+      }
+
+      const size_t equal = EqualRun(current, previous, literalEnd, size);
+      if (equal >= MIN_ZERO_RUN || literalEnd + equal >= size)
+        break;
+
+      literalEnd += equal;
+    }
+
+    const size_t literals = literalEnd - position;
+
+    WriteVarint(encoded, zeros);
+    WriteVarint(encoded, literals);
+
+    const size_t offset = encoded.size();
+    encoded.resize(offset + literals);
+    for (size_t i = 0; i < literals; i++)
+      encoded[offset + i] = current[position + i] ^ PreviousByte(previous, position + i);
+
+    position = literalEnd;
+  }
+}
+
+bool CDeltaCodec::Apply(const uint8_t* encoded, size_t encodedSize, uint8_t* target, size_t targetSize)
+{
+  size_t readPosition = 0;
+  size_t writePosition = 0;
+
+  while (readPosition < encodedSize)
+  {
+    size_t zeros;
+    size_t literals;
+    if (!ReadVarint(encoded, encodedSize, readPosition, zeros) ||
+        !ReadVarint(encoded, encodedSize, readPosition, literals))
+      return false;
+
+    if (zeros > targetSize - writePosition)
+      return false;
+    writePosition += zeros;
+
+    if (literals > targetSize - writePosition || literals > encodedSize - readPosition)
+      return false;
+
+    for (size_t i = 0; i < literals; i++)
+      target[writePosition + i] ^= encoded[readPosition + i];
+
+    writePosition += literals;
+    readPosition += literals;
+  }
+
+  return true;
+}
+
+size_t CDeltaCodec::MaxEncodedSize(size_t size)
+{
+  // A single literal run of the whole buffer, plus two varints
+  return size + 2 * (sizeof(size_t) * 8 / 7 + 1);
+}
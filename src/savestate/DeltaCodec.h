@@ -0,0 +1,61 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Compression of the difference between two save states
+   *
+   * Consecutive save states are mostly identical, so their XOR is mostly
+   * zero. The XOR is stored as a sequence of runs:
+   *
+   *   zero count (varint), literal count (varint), literal bytes
+   *
+   * where the literals are the XOR of the two states. Trailing zeros are
+   * omitted. As XOR is its own inverse, the same delta converts either
+   * state into the other.
+   *
+   * Without a previous state, this is plain zero-run compression of a
+   * single state, which is undone by applying it to a zeroed buffer.
+   */
+  class CDeltaCodec
+  {
+  public:
+    /*!
+     * \brief Encode the difference between two buffers of the same size
+     *
+     * \param current The new data
+     * \param previous The old data, or null to compress against zeros
+     * \param size The size of both buffers
+     * \param[out] encoded The delta, replacing any previous contents
+     */
+    static void Encode(const uint8_t* current, const uint8_t* previous, size_t size, std::vector<uint8_t>& encoded);
+
+    /*!
+     * \brief Apply a delta to a buffer in place
+     *
+     * \param encoded The delta
+     * \param encodedSize The size of the delta
+     * \param target The buffer holding either of the two encoded states
+     * \param targetSize The size of the buffer
+     *
+     * \return False if the delta is corrupt or doesn't fit the buffer
+     */
+    static bool Apply(const uint8_t* encoded, size_t encodedSize, uint8_t* target, size_t targetSize);
+
+    /*!
+     * \brief Upper bound of the size of a delta of buffers of the given size
+     */
+    static size_t MaxEncodedSize(size_t size);
+  };
+}
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "DirtyPageTracker.h"
+#include "libretro/MemoryMap.h"
+#include "log/Log.h"
+#include "utils/FrameProfiler.h"
+#include "utils/MemoryHash.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace LIBRETRO;
+
+#define DIRTY_PAGE_SIZE    4096
+
+void CDirtyPageTracker::Initialize(const CMemoryMap& memoryMap)
+{
+  Deinitialize();
+
+  // Collect writable memory. Descriptors often map the same memory more
+  // than once (mirrors, banks), so overlapping ranges are merged.
+  std::vector<std::pair<uint8_t*, uint8_t*>> ranges;
+  for (size_t i = 0; i < memoryMap.Size(); i++)
+  {
+    const retro_memory_descriptor_kodi& desc = memoryMap[static_cast<int>(i)];
+
+    if (desc.descriptor.ptr == nullptr || (desc.descriptor.flags & RETRO_MEMDESC_CONST) != 0)
+      continue;
+
+    // Lengths inferred from the address mask may exceed the real memory
+    if (desc.reportedLength == 0)
+      continue;
+
+    uint8_t* begin = static_cast<uint8_t*>(desc.descriptor.ptr) + desc.descriptor.offset;
+    ranges.emplace_back(begin, begin + desc.reportedLength);
+  }
+
+  std::sort(ranges.begin(), ranges.end());
+
+  for (const auto& range : ranges)
+  {
+    if (!m_regions.empty())
+    {
+      Region& last = m_regions.back();
+      if (range.first <= last.data + last.size)
+      {
+        last.size = std::max(last.size, static_cast<size_t>(range.second - last.data));
+        continue;
+      }
+    }
+
+    m_regions.push_back(Region{ range.first, static_cast<size_t>(range.second - range.first), 0 });
+  }
+
+  size_t pageCount = 0;
+  for (Region& region : m_regions)
+  {
+    region.firstPage = pageCount;
+    pageCount += (region.size + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+  }
+
+  if (pageCount == 0)
+  {
+    esyslog("Dirty page tracking: core has no writable memory maps, disabling");
+    Deinitialize();
+    return;
+  }
+
+  // Take the initial hashes, so the first scan reports the first changes
+  m_hashes.resize(pageCount);
+  for (const Region& region : m_regions)
+  {
+    const size_t regionPages = (region.size + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+    for (size_t page = 0; page < regionPages; page++)
+    {
+      m_hashes[region.firstPage + page] =
+          CMemoryHash::Compute(region.data + page * DIRTY_PAGE_SIZE, PageSize(region, page));
+    }
+  }
+
+  isyslog("Dirty page tracking: %u region(s), %u KB in %u pages", static_cast<unsigned int>(m_regions.size()),
+      static_cast<unsigned int>(TrackedBytes() / 1024), static_cast<unsigned int>(pageCount));
+}
+
+void CDirtyPageTracker::Deinitialize()
+{
+  m_regions.clear();
+  m_hashes.clear();
+  m_hashes.shrink_to_fit();
+  m_dirtyPagesPerScan.Reset();
+  m_scanNs = 0;
+}
+
+size_t CDirtyPageTracker::Scan()
+{
+  if (!IsEnabled())
+    return 0;
+
+  const int64_t startNs = CFrameProfiler::Now();
+
+  size_t dirtyPages = 0;
+
+  for (size_t regionIndex = 0; regionIndex < m_regions.size(); regionIndex++)
+  {
+    const Region& region = m_regions[regionIndex];
+    const size_t regionPages = (region.size + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+
+    for (size_t page = 0; page < regionPages; page++)
+    {
+      const uint64_t hash = CMemoryHash::Compute(region.data + page * DIRTY_PAGE_SIZE, PageSize(region, page));
+
+      uint64_t& previousHash = m_hashes[region.firstPage + page];
+      if (hash != previousHash)
+      {
+        previousHash = hash;
+        dirtyPages++;
+      }
+    }
+  }
+
+  m_scanNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+  m_dirtyPagesPerScan.Add(dirtyPages);
+
+  return dirtyPages;
+}
+
+size_t CDirtyPageTracker::TrackedBytes() const
+{
+  size_t bytes = 0;
+  for (const Region& region : m_regions)
+    bytes += region.size;
+  return bytes;
+}
+
+void CDirtyPageTracker::LogStatistics() const
+{
+  const uint64_t scans = m_dirtyPagesPerScan.Count();
+  if (scans == 0)
+    return;
+
+  isyslog("Dirty page tracking: %llu scans of %u pages, avg scan %.1f us",
+      static_cast<unsigned long long>(scans), static_cast<unsigned int>(PageCount()),
+      m_scanNs / 1000.0 / scans);
+  isyslog("Dirty page tracking: dirty pages per frame p50: %llu  p99: %llu  max: %llu (%u bytes per page)",
+      static_cast<unsigned long long>(m_dirtyPagesPerScan.Percentile(0.5)),
+      static_cast<unsigned long long>(m_dirtyPagesPerScan.Percentile(0.99)),
+      static_cast<unsigned long long>(m_dirtyPagesPerScan.Max()), DIRTY_PAGE_SIZE);
+}
+
+size_t CDirtyPageTracker::PageSize(const Region& region, size_t page) const
+{
+  return std::min(static_cast<size_t>(DIRTY_PAGE_SIZE), region.size - page * DIRTY_PAGE_SIZE);
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "utils/Histogram.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CMemoryMap;
+
+  /*!
+   * \brief Tracks which pages of the core's memory change between frames
+   *
+   * Only works for cores that publish their memory with
+   * RETRO_ENVIRONMENT_SET_MEMORY_MAPS. Every writable region is split into
+   * pages, and each page is hashed on every scan. Pages whose hash differs
+   * from the previous scan are dirty.
+   *
+   * This is a diagnostic: the statistics show how much of the memory a core
+   * writes per frame, which tells how well incremental snapshots would work
+   * for it. Memory maps don't cover the whole state of a core (CPU
+   * registers, hardware state), so such snapshots could only complement
+   * full save states, not replace them.
+   */
+  class CDirtyPageTracker
+  {
+  public:
+    CDirtyPageTracker() = default;
+
+    /*!
+     * \brief Start tracking the writable regions of a memory map
+     */
+    void Initialize(const CMemoryMap& memoryMap);
+    void Deinitialize();
+
+    bool IsEnabled() const { return !m_regions.empty(); }
+
+    /*!
+     * \brief Hash all pages and find the ones that changed since the last scan
+     *
+     * \return The number of dirty pages
+     */
+    size_t Scan();
+
+    size_t PageCount() const { return m_hashes.size(); }
+    size_t TrackedBytes() const;
+
+    void LogStatistics() const;
+
+  private:
+    struct Region
+    {
+      uint8_t* data;
+      size_t size;
+      size_t firstPage; // Index of the region's first page in m_hashes
+    };
+
+    size_t PageSize(const Region& region, size_t page) const;
+
+    std::vector<Region> m_regions;
+    std::vector<uint64_t> m_hashes;
+
+    // Statistics
+    CHistogram m_dirtyPagesPerScan;
+    uint64_t m_scanNs = 0;
+  };
+}
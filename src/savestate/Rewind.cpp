@@ -0,0 +1,357 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Rewind.h"
+#include "DeltaCodec.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "log/Log.h"
+
+#include <string.h>
+#include <utility>
+
+using namespace LIBRETRO;
+
+// The budget must hold the current state, the capture buffer, the encode
+// buffer and at least one worst-case delta
+#define MIN_BUDGET_STATES  4
+
+void CRewind::Initialize(CLibretroDLL* client, size_t memoryBudget, unsigned int interval)
+{
+  m_client = client;
+  m_memoryBudget = memoryBudget;
+  m_interval = interval > 0 ? interval : 1;
+
+  m_captures = 0;
+  m_stateBytes = 0;
+  m_deltaBytes = 0;
+  m_dropped = 0;
+  m_steps = 0;
+
+  if (m_memoryBudget == 0)
+  {
+    Deinitialize();
+    return;
+  }
+
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  const size_t stateSize = capabilities.SerializeSize(*m_client);
+  if (stateSize == 0 && !capabilities.IsInitializing())
+  {
+    esyslog("Rewind: core doesn't support save states, disabling");
+    Disable();
+    return;
+  }
+
+  // Buffers are allocated on the first capture if the size isn't known yet
+  if (stateSize > 0 && !ResizeStateBuffers(stateSize))
+  {
+    Disable();
+    return;
+  }
+
+  isyslog("Rewind: enabled every %u frame(s), state size %u bytes, %u KB for history",
+      m_interval, static_cast<unsigned int>(stateSize), static_cast<unsigned int>(m_buffer.size() / 1024));
+}
+
+void CRewind::Deinitialize()
+{
+  m_client = nullptr;
+
+  Invalidate();
+
+  m_currentState.clear();
+  m_currentState.shrink_to_fit();
+  m_nextState.clear();
+  m_nextState.shrink_to_fit();
+  m_encoded.clear();
+  m_encoded.shrink_to_fit();
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+}
+
+void CRewind::OnFrameEnd()
+{
+  if (!IsEnabled())
+    return;
+
+  if (++m_framesSinceCapture < m_interval)
+    return;
+
+  m_framesSinceCapture = 0;
+
+  if (!Capture())
+  {
+    esyslog("Rewind: failed to save state, disabling");
+    Disable();
+  }
+}
+
+unsigned int CRewind::StepBack(unsigned int steps)
+{
+  if (!IsEnabled() || !m_bHasState || steps == 0)
+    return 0;
+
+  unsigned int taken = 0;
+
+  // Undo the frames emulated since the newest snapshot
+  if (m_framesSinceCapture > 0)
+    taken++;
+
+  while (taken < steps && m_deltaCount > 0)
+  {
+    // Find the newest delta from its trailer
+    uint64_t footprint;
+    memcpy(&footprint, m_buffer.data() + m_head - sizeof(footprint), sizeof(footprint));
+
+    const size_t position = m_head - static_cast<size_t>(footprint);
+
+    DeltaHeader header;
+    memcpy(&header, m_buffer.data() + position, sizeof(header));
+
+    const uint8_t* encoded = m_buffer.data() + position + sizeof(header);
+    if (!CDeltaCodec::Apply(encoded, static_cast<size_t>(header.size), m_currentState.data(), m_currentState.size()))
+    {
+      esyslog("Rewind: history is corrupt, discarding it");
+      Invalidate();
+      return taken;
+    }
+
+    m_currentStateSize = static_cast<size_t>(header.stateSize);
+
+    m_head = position;
+    m_bufferUsed -= static_cast<size_t>(footprint);
+    m_deltaCount--;
+
+    if (m_deltaCount == 0)
+    {
+      ClearHistory();
+    }
+    else if (m_head == 0)
+    {
+      // The ring is no longer wrapped around
+      m_head = m_wrapEnd;
+      m_wrapEnd = 0;
+    }
+
+    taken++;
+  }
+
+  if (taken > 0)
+  {
+    if (!LoadCurrent())
+      return 0;
+
+    m_framesSinceCapture = 0;
+    m_steps += taken;
+  }
+
+  return taken;
+}
+
+void CRewind::Invalidate()
+{
+  ClearHistory();
+  m_bHasState = false;
+  m_currentStateSize = 0;
+  m_framesSinceCapture = 0;
+}
+
+size_t CRewind::SnapshotCount() const
+{
+  return m_deltaCount + (m_bHasState ? 1 : 0);
+}
+
+size_t CRewind::MemoryUsage() const
+{
+  return m_currentState.capacity() + m_nextState.capacity() + m_encoded.capacity() + m_buffer.capacity();
+}
+
+void CRewind::LogStatistics() const
+{
+  if (m_captures == 0)
+    return;
+
+  const double ratio = m_stateBytes > 0 ? static_cast<double>(m_deltaBytes) / m_stateBytes : 0.0;
+
+  isyslog("Rewind: %llu snapshots taken, %u available, %llu dropped, %llu steps back",
+      static_cast<unsigned long long>(m_captures), static_cast<unsigned int>(SnapshotCount()),
+      static_cast<unsigned long long>(m_dropped), static_cast<unsigned long long>(m_steps));
+  isyslog("Rewind: deltas are %.2f%% of state size, history uses %u of %u KB, %u KB allocated in total",
+      ratio * 100.0, static_cast<unsigned int>(m_bufferUsed / 1024),
+      static_cast<unsigned int>(m_buffer.size() / 1024), static_cast<unsigned int>(MemoryUsage() / 1024));
+}
+
+bool CRewind::Capture()
+{
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  const size_t stateSize = capabilities.SerializeSize(*m_client);
+  if (stateSize == 0)
+    return capabilities.IsInitializing();
+
+  if (stateSize > m_nextState.size())
+  {
+    // Existing deltas were computed for the smaller buffers, and the ring
+    // must shrink to stay within budget
+    dsyslog("Rewind: state size increased to %u bytes, discarding history", static_cast<unsigned int>(stateSize));
+    Invalidate();
+
+    if (!ResizeStateBuffers(stateSize))
+      return false;
+  }
+
+  if (!capabilities.Serialize(*m_client, m_nextState.data(), stateSize))
+  {
+    // Failures are expected until the core is initialized
+    return capabilities.IsInitializing();
+  }
+
+  // Clear any leftovers from a larger state, so padding always diffs as zero
+  memset(m_nextState.data() + stateSize, 0, m_nextState.size() - stateSize);
+
+  if (m_bHasState)
+  {
+    CDeltaCodec::Encode(m_nextState.data(), m_currentState.data(), m_nextState.size(), m_encoded);
+    Store(m_currentStateSize);
+
+    m_deltaBytes += m_encoded.size();
+    m_stateBytes += stateSize;
+  }
+
+  std::swap(m_currentState, m_nextState);
+  m_currentStateSize = stateSize;
+  m_bHasState = true;
+
+  m_captures++;
+
+  return true;
+}
+
+bool CRewind::ResizeStateBuffers(size_t stateSize)
+{
+  if (stateSize > m_memoryBudget / MIN_BUDGET_STATES)
+  {
+    esyslog("Rewind: budget of %u KB is too small for states of %u KB",
+        static_cast<unsigned int>(m_memoryBudget / 1024), static_cast<unsigned int>(stateSize / 1024));
+    return false;
+  }
+
+  const size_t maxEncodedSize = CDeltaCodec::MaxEncodedSize(stateSize);
+
+  m_currentState.assign(stateSize, 0);
+  m_nextState.assign(stateSize, 0);
+  m_encoded.clear();
+  m_encoded.reserve(maxEncodedSize);
+
+  // The rest of the budget holds the history
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_buffer.resize(m_memoryBudget - 2 * stateSize - maxEncodedSize);
+
+  return true;
+}
+
+void CRewind::Store(size_t stateSize)
+{
+  const size_t size = m_encoded.size();
+  const size_t footprint = sizeof(DeltaHeader) + size + sizeof(uint64_t);
+
+  if (footprint > m_buffer.size())
+  {
+    // The new state can't be linked to the older ones
+    m_dropped += m_deltaCount;
+    ClearHistory();
+    return;
+  }
+
+  // Drop the oldest deltas until there is room at the write position
+  while (m_deltaCount > 0)
+  {
+    if (m_head <= m_tail)
+    {
+      // Wrapped around, the free space ends at the oldest delta
+      if (m_head + footprint <= m_tail)
+        break;
+
+      DropOldest();
+    }
+    else
+    {
+      // The free space extends to the end of the buffer
+      if (m_head + footprint <= m_buffer.size())
+        break;
+
+      m_wrapEnd = m_head;
+      m_head = 0;
+    }
+  }
+
+  uint8_t* dest = m_buffer.data() + m_head;
+
+  const DeltaHeader header{ size, stateSize };
+  memcpy(dest, &header, sizeof(header));
+  memcpy(dest + sizeof(header), m_encoded.data(), size);
+
+  const uint64_t trailer = footprint;
+  memcpy(dest + sizeof(header) + size, &trailer, sizeof(trailer));
+
+  m_head += footprint;
+  m_bufferUsed += footprint;
+  m_deltaCount++;
+}
+
+void CRewind::DropOldest()
+{
+  DeltaHeader header;
+  memcpy(&header, m_buffer.data() + m_tail, sizeof(header));
+
+  const size_t footprint = sizeof(DeltaHeader) + static_cast<size_t>(header.size) + sizeof(uint64_t);
+
+  m_tail += footprint;
+  m_bufferUsed -= footprint;
+  m_deltaCount--;
+  m_dropped++;
+
+  if (m_deltaCount == 0)
+  {
+    ClearHistory();
+  }
+  else if (m_wrapEnd != 0 && m_tail == m_wrapEnd)
+  {
+    // The deltas before the wrap are gone
+    m_tail = 0;
+    m_wrapEnd = 0;
+  }
+}
+
+void CRewind::ClearHistory()
+{
+  m_head = 0;
+  m_tail = 0;
+  m_wrapEnd = 0;
+  m_deltaCount = 0;
+  m_bufferUsed = 0;
+}
+
+bool CRewind::LoadCurrent()
+{
+  if (!m_client->retro_unserialize(m_currentState.data(), m_currentStateSize))
+  {
+    esyslog("Rewind: failed to restore state, disabling");
+    Disable();
+    return false;
+  }
+
+  return true;
+}
+
+void CRewind::Disable()
+{
+  Deinitialize();
+}
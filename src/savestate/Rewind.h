@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief In-memory rewind history
+   *
+   * Every K frames the core's state is saved. Only the newest state is kept
+   * in full. Older states are kept as deltas (see CDeltaCodec), each of
+   * which converts a state into the one captured before it. Deltas are
+   * stored back to back in a fixed-size ring buffer together with their
+   * bookkeeping, so memory use never grows past the budget, and the oldest
+   * are dropped when it fills up.
+   *
+   * Stepping back applies the newest delta to the current state and loads
+   * the result into the core.
+   */
+  class CRewind
+  {
+  public:
+    CRewind() = default;
+
+    /*!
+     * \brief Prepare rewind for a loaded game
+     *
+     * \param client The libretro core
+     * \param memoryBudget The total memory in bytes that may be used, or 0
+     *        to disable rewind
+     * \param interval The number of frames between snapshots
+     */
+    void Initialize(CLibretroDLL* client, size_t memoryBudget, unsigned int interval);
+    void Deinitialize();
+
+    bool IsEnabled() const { return m_client != nullptr; }
+
+    /*!
+     * \brief Call after every emulated frame to capture snapshots
+     */
+    void OnFrameEnd();
+
+    /*!
+     * \brief Restore an earlier state
+     *
+     * The first step after frames were emulated returns to the newest
+     * snapshot. Each further step goes back one snapshot.
+     *
+     * \param steps The number of snapshots to go back
+     *
+     * \return The number of steps taken, less than requested if the history
+     *         ran out
+     */
+    unsigned int StepBack(unsigned int steps);
+
+    /*!
+     * \brief Forget the history, e.g. after the game was reset
+     */
+    void Invalidate();
+
+    /*!
+     * \brief Number of states that can currently be restored
+     */
+    size_t SnapshotCount() const;
+
+    /*!
+     * \brief Memory in use by the history and its work buffers, in bytes
+     */
+    size_t MemoryUsage() const;
+
+    void LogStatistics() const;
+
+  private:
+    /*!
+     * \brief Bookkeeping in front of each delta in the ring buffer
+     *
+     * Each delta is followed by its total size in the ring, so that the
+     * newest can be found by walking back from the write position.
+     */
+    struct DeltaHeader
+    {
+      uint64_t size; // Size of the encoded delta
+      uint64_t stateSize; // Size of the state the delta converts to
+    };
+
+    bool Capture();
+    bool ResizeStateBuffers(size_t stateSize);
+    void Store(size_t stateSize);
+    void DropOldest();
+    void ClearHistory();
+    bool LoadCurrent();
+    void Disable();
+
+    // Construction parameters
+    CLibretroDLL* m_client = nullptr;
+    size_t m_memoryBudget = 0;
+    unsigned int m_interval = 1;
+
+    // Newest state, and the buffer the next state is captured into. Both are
+    // padded with zeros to the same size, so variable-size states can be
+    // diffed.
+    std::vector<uint8_t> m_currentState;
+    std::vector<uint8_t> m_nextState;
+    size_t m_currentStateSize = 0;
+    bool m_bHasState = false;
+    std::vector<uint8_t> m_encoded;
+
+    // Ring buffer of deltas. Deltas are in [m_tail, m_head), or if the ring
+    // has wrapped around, in [m_tail, m_wrapEnd) followed by [0, m_head).
+    std::vector<uint8_t> m_buffer;
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    size_t m_wrapEnd = 0;
+    size_t m_deltaCount = 0;
+    size_t m_bufferUsed = 0;
+
+    unsigned int m_framesSinceCapture = 0;
+
+    // Statistics
+    uint64_t m_captures = 0;
+    uint64_t m_stateBytes = 0;
+    uint64_t m_deltaBytes = 0;
+    uint64_t m_dropped = 0;
+    uint64_t m_steps = 0;
+  };
+}
@@ -0,0 +1,524 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "SaveStateService.h"
+#include "DeltaCodec.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "libretro-common/libretro.h"
+#include "log/Log.h"
+#include "utils/Crc32.h"
+#include "utils/FrameProfiler.h"
+
+#include <kodi/Filesystem.h>
+
+#include <algorithm>
+#include <random>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define SAVESTATE_MAGIC           "KLRS"
+#define SAVESTATE_VERSION         2
+#define SAVESTATE_HEADER_SIZE     48 // Magic, version, state size, CRC, compressed size, quirks, session, platform
+#define SAVESTATE_V1_VERSION      1
+#define SAVESTATE_V1_HEADER_SIZE  28 // Without quirks, session and platform
+#define MAX_PENDING_SAVES         4
+#define MAX_POOLED_BUFFERS        (MAX_PENDING_SAVES + 1) // Pending saves and the one being written
+#define BACKUP_SUFFIX             ".bak"
+
+#if defined(_WIN32)
+  #define SAVESTATE_OS  1
+#elif defined(__ANDROID__)
+  #define SAVESTATE_OS  2
+#elif defined(__APPLE__)
+  #define SAVESTATE_OS  3
+#elif defined(__linux__)
+  #define SAVESTATE_OS  4
+#else
+  #define SAVESTATE_OS  0
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define SAVESTATE_ARCH  1
+#elif defined(__i386__) || defined(_M_IX86)
+  #define SAVESTATE_ARCH  2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define SAVESTATE_ARCH  3
+#elif defined(__arm__) || defined(_M_ARM)
+  #define SAVESTATE_ARCH  4
+#else
+  #define SAVESTATE_ARCH  0
+#endif
+
+namespace
+{
+  /*!
+   * \brief Identify the machine that wrote a state
+   *
+   * The top byte is the byte order, checked for cores with endian-dependent
+   * states. The rest is the OS, CPU architecture and pointer size, checked
+   * for cores with platform-dependent states.
+   */
+  uint32_t PlatformId()
+  {
+    const uint16_t probe = 1;
+    const uint32_t bigEndian = *reinterpret_cast<const uint8_t*>(&probe) == 1 ? 0 : 1;
+
+    return bigEndian << 24 | SAVESTATE_OS << 16 | SAVESTATE_ARCH << 8 | static_cast<uint32_t>(sizeof(void*));
+  }
+
+  void WriteU32(uint8_t* buffer, uint32_t value)
+  {
+    for (unsigned int i = 0; i < 4; i++)
+      buffer[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+
+  void WriteU64(uint8_t* buffer, uint64_t value)
+  {
+    WriteU32(buffer, static_cast<uint32_t>(value));
+    WriteU32(buffer + 4, static_cast<uint32_t>(value >> 32));
+  }
+
+  uint32_t ReadU32(const uint8_t* buffer)
+  {
+    return buffer[0] |
+           static_cast<uint32_t>(buffer[1]) << 8 |
+           static_cast<uint32_t>(buffer[2]) << 16 |
+           static_cast<uint32_t>(buffer[3]) << 24;
+  }
+
+  uint64_t ReadU64(const uint8_t* buffer)
+  {
+    return ReadU32(buffer) | static_cast<uint64_t>(ReadU32(buffer + 4)) << 32;
+  }
+}
+
+void CSaveStateService::Initialize(CLibretroDLL* client)
+{
+  Deinitialize();
+
+  m_client = client;
+  m_bStop = false;
+
+  // States of single-session cores can only be loaded while this game stays
+  // loaded, including states saved by an earlier run of Kodi
+  std::random_device random;
+  m_sessionId = static_cast<uint64_t>(random()) << 32 | random();
+
+  m_saves = 0;
+  m_failures = 0;
+  m_rejected = 0;
+  m_snapshotNs = 0;
+  m_maxSnapshotNs = 0;
+  m_writeNs = 0;
+  m_stateBytes = 0;
+  m_writtenBytes = 0;
+
+  // Allocate the snapshot buffers up front, so that saving doesn't allocate
+  // on the emulation thread. Cores that don't know their state size yet
+  // fill the pool on their first saves.
+  const size_t stateSize = CLibretroEnvironment::Get().StateCapabilities().SerializeSize(*m_client);
+  if (stateSize > 0)
+  {
+    m_bufferPool.resize(MAX_POOLED_BUFFERS);
+    for (std::vector<uint8_t>& buffer : m_bufferPool)
+      buffer.resize(stateSize);
+  }
+
+  m_thread = std::thread(&CSaveStateService::Process, this);
+}
+
+void CSaveStateService::Deinitialize()
+{
+  if (m_thread.joinable())
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_bStop = true;
+    }
+    m_jobCondition.notify_all();
+
+    // The worker finishes pending saves before exiting
+    m_thread.join();
+  }
+
+  ProcessCompletions();
+
+  m_client = nullptr;
+  m_bufferPool.clear();
+  m_compressed.clear();
+  m_compressed.shrink_to_fit();
+}
+
+bool CSaveStateService::Save(const std::string& path, SaveStateCallback callback)
+{
+  if (m_client == nullptr || !m_thread.joinable())
+    return false;
+
+  const int64_t startNs = CFrameProfiler::Now();
+
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  const size_t stateSize = capabilities.SerializeSize(*m_client);
+  if (stateSize == 0)
+  {
+    esyslog("Save state: core can't save states%s", capabilities.IsInitializing() ? " yet" : "");
+    m_failures++;
+    return false;
+  }
+
+  std::vector<uint8_t> buffer;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_pending.size() >= MAX_PENDING_SAVES)
+    {
+      esyslog("Save state: %u saves pending, rejecting \"%s\"", static_cast<unsigned int>(m_pending.size()),
+          path.c_str());
+      m_rejected++;
+      return false;
+    }
+
+    if (!m_bufferPool.empty())
+    {
+      buffer = std::move(m_bufferPool.back());
+      m_bufferPool.pop_back();
+    }
+  }
+
+  // Reused buffers only reallocate if the state has grown
+  if (buffer.size() < stateSize)
+    buffer.resize(stateSize);
+
+  if (!capabilities.Serialize(*m_client, buffer.data(), stateSize))
+  {
+    esyslog("Save state: failed to serialize state for \"%s\"", path.c_str());
+    m_failures++;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_bufferPool.size() < MAX_POOLED_BUFFERS)
+      m_bufferPool.emplace_back(std::move(buffer));
+
+    return false;
+  }
+
+  SaveJob job;
+  job.path = path;
+  job.state = std::move(buffer);
+  job.stateSize = stateSize;
+  job.quirks = capabilities.Quirks();
+  job.callback = std::move(callback);
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pending.emplace_back(std::move(job));
+  }
+  m_jobCondition.notify_one();
+
+  const uint64_t elapsedNs = static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+  m_snapshotNs += elapsedNs;
+  m_maxSnapshotNs = std::max(m_maxSnapshotNs, elapsedNs);
+  m_saves++;
+
+  return true;
+}
+
+bool CSaveStateService::Load(const std::string& path)
+{
+  if (m_client == nullptr)
+    return false;
+
+  WaitForPendingSaves();
+
+  CStateCapabilities& capabilities = CLibretroEnvironment::Get().StateCapabilities();
+
+  const size_t maxStateSize = capabilities.SerializeSize(*m_client);
+  if (maxStateSize == 0)
+  {
+    esyslog("Save state: core can't load states%s", capabilities.IsInitializing() ? " yet" : "");
+    return false;
+  }
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFile(path))
+  {
+    esyslog("Save state: failed to open \"%s\"", path.c_str());
+    return false;
+  }
+
+  const int64_t length = file.GetLength();
+  if (length < SAVESTATE_V1_HEADER_SIZE)
+  {
+    esyslog("Save state: \"%s\" is too small", path.c_str());
+    return false;
+  }
+
+  if (static_cast<uint64_t>(length) > SAVESTATE_HEADER_SIZE + CDeltaCodec::MaxEncodedSize(maxStateSize))
+  {
+    esyslog("Save state: \"%s\" is too large for this core", path.c_str());
+    return false;
+  }
+
+  std::vector<uint8_t> data(static_cast<size_t>(length));
+  if (file.Read(data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+  {
+    esyslog("Save state: failed to read \"%s\"", path.c_str());
+    return false;
+  }
+  file.Close();
+
+  const uint32_t version = ReadU32(data.data() + 4);
+  if (memcmp(data.data(), SAVESTATE_MAGIC, 4) != 0 || (version != SAVESTATE_VERSION && version != SAVESTATE_V1_VERSION))
+  {
+    esyslog("Save state: \"%s\" is not a save state or has an unsupported version", path.c_str());
+    return false;
+  }
+
+  const size_t headerSize = version == SAVESTATE_VERSION ? SAVESTATE_HEADER_SIZE : SAVESTATE_V1_HEADER_SIZE;
+  if (data.size() < headerSize)
+  {
+    esyslog("Save state: \"%s\" is too small", path.c_str());
+    return false;
+  }
+
+  const uint64_t stateSize = ReadU64(data.data() + 8);
+  const uint32_t crc = ReadU32(data.data() + 16);
+  const uint64_t compressedSize = ReadU64(data.data() + 20);
+
+  if (compressedSize != data.size() - headerSize)
+  {
+    esyslog("Save state: \"%s\" is truncated", path.c_str());
+    return false;
+  }
+
+  if (version == SAVESTATE_VERSION)
+  {
+    if (!IsCompatible(path, ReadU64(data.data() + 28), ReadU64(data.data() + 36), ReadU32(data.data() + 44)))
+      return false;
+  }
+  else if (capabilities.IsSingleSession() || !capabilities.IsPortable())
+  {
+    // Older states don't say where they were saved
+    esyslog("Save state: \"%s\" doesn't record the session or platform this core needs", path.c_str());
+    return false;
+  }
+
+  // The size comes from the file, so check it before allocating. States of
+  // cores with variable-size states may be smaller than the current size.
+  const bool bValidSize = capabilities.IsVariableSize() ? (stateSize > 0 && stateSize <= maxStateSize) :
+                                                          stateSize == maxStateSize;
+  if (!bValidSize)
+  {
+    esyslog("Save state: \"%s\" has a state size of %llu bytes, core expects %llu bytes", path.c_str(),
+        static_cast<unsigned long long>(stateSize), static_cast<unsigned long long>(maxStateSize));
+    return false;
+  }
+
+  std::vector<uint8_t> state(static_cast<size_t>(stateSize));
+  if (!CDeltaCodec::Apply(data.data() + headerSize, data.size() - headerSize,
+                          state.data(), state.size()) ||
+      CCrc32::Compute(state.data(), state.size()) != crc)
+  {
+    esyslog("Save state: \"%s\" is corrupt", path.c_str());
+    return false;
+  }
+
+  if (!m_client->retro_unserialize(state.data(), state.size()))
+  {
+    esyslog("Save state: core failed to load \"%s\"", path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool CSaveStateService::IsCompatible(const std::string& path, uint64_t savedQuirks, uint64_t sessionId, uint32_t platformId) const
+{
+  // The quirks of either core apply, in case the core was updated
+  const uint64_t quirks = savedQuirks | CLibretroEnvironment::Get().StateCapabilities().Quirks();
+
+  if ((quirks & RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION) && sessionId != m_sessionId)
+  {
+    esyslog("Save state: \"%s\" is from an earlier session, core can't load it", path.c_str());
+    return false;
+  }
+
+  const uint32_t currentPlatformId = PlatformId();
+
+  if ((quirks & RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT) && (platformId >> 24) != (currentPlatformId >> 24))
+  {
+    esyslog("Save state: \"%s\" was saved with a different byte order", path.c_str());
+    return false;
+  }
+
+  if ((quirks & RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT) && (platformId & 0xffffff) != (currentPlatformId & 0xffffff))
+  {
+    esyslog("Save state: \"%s\" was saved on a different platform", path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void CSaveStateService::ProcessCompletions()
+{
+  std::deque<SaveJob> completed;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    completed.swap(m_completed);
+  }
+
+  for (SaveJob& job : completed)
+  {
+    if (!job.bSuccess)
+      m_failures++;
+
+    if (job.callback)
+      job.callback(job.path, job.bSuccess);
+  }
+}
+
+void CSaveStateService::LogStatistics() const
+{
+  if (m_saves == 0)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  isyslog("Save states: %llu saved, %llu failed, %llu rejected",
+      static_cast<unsigned long long>(m_saves), static_cast<unsigned long long>(m_failures),
+      static_cast<unsigned long long>(m_rejected));
+  isyslog("Save states: snapshot avg %.1f us, max %.1f us on the emulation thread, write avg %.1f us in the background",
+      m_snapshotNs / 1000.0 / m_saves, m_maxSnapshotNs / 1000.0, m_writeNs / 1000.0 / m_saves);
+
+  if (m_stateBytes > 0)
+  {
+    isyslog("Save states: compressed to %.1f%% of state size",
+        100.0 * m_writtenBytes / m_stateBytes);
+  }
+}
+
+void CSaveStateService::Process()
+{
+  while (true)
+  {
+    SaveJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_jobCondition.wait(lock, [this]() { return m_bStop || !m_pending.empty(); });
+
+      if (m_pending.empty())
+        break;
+
+      job = std::move(m_pending.front());
+      m_pending.pop_front();
+      m_bBusy = true;
+    }
+
+    const int64_t startNs = CFrameProfiler::Now();
+
+    job.bSuccess = WriteState(job);
+
+    const uint64_t elapsedNs = static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_writeNs += elapsedNs;
+      m_stateBytes += job.stateSize;
+      if (job.bSuccess)
+        m_writtenBytes += m_compressed.size();
+
+      if (m_bufferPool.size() < MAX_POOLED_BUFFERS)
+        m_bufferPool.emplace_back(std::move(job.state));
+
+      m_completed.emplace_back(std::move(job));
+      m_bBusy = false;
+    }
+    m_idleCondition.notify_all();
+  }
+}
+
+bool CSaveStateService::WriteState(const SaveJob& job)
+{
+  CDeltaCodec::Encode(job.state.data(), nullptr, job.stateSize, m_compressed);
+
+  uint8_t header[SAVESTATE_HEADER_SIZE];
+  memcpy(header, SAVESTATE_MAGIC, 4);
+  WriteU32(header + 4, SAVESTATE_VERSION);
+  WriteU64(header + 8, job.stateSize);
+  WriteU32(header + 16, CCrc32::Compute(job.state.data(), job.stateSize));
+  WriteU64(header + 20, m_compressed.size());
+  WriteU64(header + 28, job.quirks);
+  WriteU64(header + 36, m_sessionId);
+  WriteU32(header + 44, PlatformId());
+
+  // Write to a temporary file first, so a failed save never destroys the
+  // previous one
+  const std::string tempPath = job.path + ".tmp";
+
+  {
+    kodi::vfs::CFile file;
+    if (!file.OpenFileForWrite(tempPath, true))
+    {
+      esyslog("Save state: failed to open \"%s\" for writing", tempPath.c_str());
+      return false;
+    }
+
+    if (file.Write(header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+        file.Write(m_compressed.data(), m_compressed.size()) != static_cast<ssize_t>(m_compressed.size()))
+    {
+      esyslog("Save state: failed to write \"%s\"", tempPath.c_str());
+      file.Close();
+      kodi::vfs::DeleteFile(tempPath);
+      return false;
+    }
+
+    file.Close();
+  }
+
+  // The previous save is kept as a backup until the new one is in place
+  const std::string backupPath = job.path + BACKUP_SUFFIX;
+  const bool bHasBackup = kodi::vfs::FileExists(job.path);
+
+  if (bHasBackup)
+  {
+    if (kodi::vfs::FileExists(backupPath))
+      kodi::vfs::DeleteFile(backupPath);
+
+    if (!kodi::vfs::RenameFile(job.path, backupPath))
+    {
+      esyslog("Save state: failed to replace \"%s\"", job.path.c_str());
+      kodi::vfs::DeleteFile(tempPath);
+      return false;
+    }
+  }
+
+  if (!kodi::vfs::RenameFile(tempPath, job.path))
+  {
+    esyslog("Save state: failed to rename \"%s\"", tempPath.c_str());
+    kodi::vfs::DeleteFile(tempPath);
+
+    if (bHasBackup && !kodi::vfs::RenameFile(backupPath, job.path))
+      esyslog("Save state: failed to restore \"%s\", previous save is in \"%s\"", job.path.c_str(), backupPath.c_str());
+
+    return false;
+  }
+
+  if (bHasBackup)
+    kodi::vfs::DeleteFile(backupPath);
+
+  return true;
+}
+
+void CSaveStateService::WaitForPendingSaves()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idleCondition.wait(lock, [this]() { return m_pending.empty() && !m_bBusy; });
+}
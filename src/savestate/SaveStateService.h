@@ -0,0 +1,152 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief Called on the emulation thread when a save has finished
+   *
+   * \param path The path of the save state
+   * \param bSuccess True if the state was written
+   */
+  using SaveStateCallback = std::function<void(const std::string& path, bool bSuccess)>;
+
+  /*!
+   * \brief Save states written to disk without stalling emulation
+   *
+   * Only the snapshot itself happens on the emulation thread, into a buffer
+   * taken from a pool that is allocated when the game is loaded.
+   * Compression, checksumming and writing are done on a worker thread.
+   * Completion callbacks are queued and invoked from ProcessCompletions(),
+   * which the frame loop calls every frame.
+   *
+   * File format (little endian):
+   *
+   *   "KLRS", version (u32), state size (u64), CRC-32 of the state (u32),
+   *   compressed size (u64), serialization quirks (u64), session (u64),
+   *   platform (u32), state compressed with CDeltaCodec
+   *
+   * The quirks decide what a state can be loaded into: states of
+   * single-session cores only in the session that saved them, and states
+   * of endian- or platform-dependent cores only on a matching machine.
+   * Version 1 files have no quirks, session or platform, and are only
+   * loaded into cores without these quirks.
+   */
+  class CSaveStateService
+  {
+  public:
+    CSaveStateService() = default;
+    ~CSaveStateService() { Deinitialize(); }
+
+    /*!
+     * \brief Start the worker thread for a loaded game
+     */
+    void Initialize(CLibretroDLL* client);
+
+    /*!
+     * \brief Finish any pending saves and stop the worker thread
+     */
+    void Deinitialize();
+
+    /*!
+     * \brief Snapshot the core and write the state in the background
+     *
+     * \param path The path to write the state to
+     * \param callback Invoked from ProcessCompletions() when done, may be empty
+     *
+     * \return False if the core couldn't be snapshotted or too many saves
+     *         are pending. The callback is not invoked in this case.
+     */
+    bool Save(const std::string& path, SaveStateCallback callback);
+
+    /*!
+     * \brief Read a state written by Save() and load it into the core
+     *
+     * This blocks until any pending saves are finished, so that the latest
+     * save to the same path is read.
+     */
+    bool Load(const std::string& path);
+
+    /*!
+     * \brief Invoke the callbacks of finished saves
+     *
+     * Must be called on the emulation thread.
+     */
+    void ProcessCompletions();
+
+    void LogStatistics() const;
+
+  private:
+    struct SaveJob
+    {
+      std::string path;
+      std::vector<uint8_t> state;
+      size_t stateSize = 0;
+      uint64_t quirks = 0;
+      SaveStateCallback callback;
+      bool bSuccess = false;
+    };
+
+    // Worker thread functions
+    void Process();
+    bool WriteState(const SaveJob& job);
+
+    /*!
+     * \brief Check the quirks, session and platform of a state being loaded
+     */
+    bool IsCompatible(const std::string& path, uint64_t savedQuirks, uint64_t sessionId, uint32_t platformId) const;
+
+    /*!
+     * \brief Wait until the worker has no pending saves
+     */
+    void WaitForPendingSaves();
+
+    // Construction parameters
+    CLibretroDLL* m_client = nullptr;
+    uint64_t m_sessionId = 0;
+
+    // Worker thread
+    std::thread m_thread;
+    bool m_bStop = false;
+    std::vector<uint8_t> m_compressed; // Only used by the worker
+
+    // Shared state
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobCondition;
+    std::condition_variable m_idleCondition;
+    std::deque<SaveJob> m_pending;
+    std::deque<SaveJob> m_completed;
+    std::vector<std::vector<uint8_t>> m_bufferPool;
+    bool m_bBusy = false;
+
+    // Statistics (emulation thread)
+    uint64_t m_saves = 0;
+    uint64_t m_failures = 0;
+    uint64_t m_rejected = 0;
+    uint64_t m_snapshotNs = 0;
+    uint64_t m_maxSnapshotNs = 0;
+
+    // Statistics (worker thread, protected by m_mutex)
+    uint64_t m_writeNs = 0;
+    uint64_t m_stateBytes = 0;
+    uint64_t m_writtenBytes = 0;
+  };
+}
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "StateCapabilities.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro-common/libretro.h"
+#include "log/Log.h"
+
+using namespace LIBRETRO;
+
+#define SUPPORTED_QUIRKS  (RETRO_SERIALIZATION_QUIRK_INCOMPLETE | \
+                           RETRO_SERIALIZATION_QUIRK_MUST_INITIALIZE | \
+                           RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE | \
+                           RETRO_SERIALIZATION_QUIRK_FRONT_VARIABLE_SIZE | \
+                           RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION | \
+                           RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT | \
+                           RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT)
+
+void CStateCapabilities::Reset()
+{
+  m_quirks = 0;
+  ResetSession();
+}
+
+void CStateCapabilities::ResetSession()
+{
+  m_bSerialized = false;
+  m_cachedSize = 0;
+}
+
+uint64_t CStateCapabilities::SetQuirks(uint64_t quirks)
+{
+  m_quirks = quirks & SUPPORTED_QUIRKS;
+
+  // Every user of states asks for the size before saving, and grows its
+  // buffers when needed
+  if (HasQuirk(RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE))
+    m_quirks |= RETRO_SERIALIZATION_QUIRK_FRONT_VARIABLE_SIZE;
+
+  m_cachedSize = 0;
+
+  dsyslog("Serialization quirks: 0x%llx%s%s%s%s%s", static_cast<unsigned long long>(m_quirks),
+      HasQuirk(RETRO_SERIALIZATION_QUIRK_INCOMPLETE) ? " incomplete" : "",
+      HasQuirk(RETRO_SERIALIZATION_QUIRK_MUST_INITIALIZE) ? " must-initialize" : "",
+      HasQuirk(RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE) ? " variable-size" : "",
+      HasQuirk(RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION) ? " single-session" : "",
+      !IsPortable() ? " not-portable" : "");
+
+  return m_quirks;
+}
+
+bool CStateCapabilities::IsIncomplete() const
+{
+  return HasQuirk(RETRO_SERIALIZATION_QUIRK_INCOMPLETE);
+}
+
+bool CStateCapabilities::IsInitializing() const
+{
+  return HasQuirk(RETRO_SERIALIZATION_QUIRK_MUST_INITIALIZE) && !m_bSerialized;
+}
+
+bool CStateCapabilities::IsVariableSize() const
+{
+  return HasQuirk(RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE);
+}
+
+bool CStateCapabilities::IsSingleSession() const
+{
+  return HasQuirk(RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION);
+}
+
+bool CStateCapabilities::IsPortable() const
+{
+  return !HasQuirk(RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT | RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT);
+}
+
+size_t CStateCapabilities::SerializeSize(CLibretroDLL& client)
+{
+  if (m_cachedSize != 0)
+    return m_cachedSize;
+
+  const size_t size = client.retro_serialize_size();
+
+  if (!IsVariableSize() && !IsInitializing())
+    m_cachedSize = size;
+
+  return size;
+}
+
+bool CStateCapabilities::Serialize(CLibretroDLL& client, uint8_t* data, size_t size)
+{
+  if (size == 0 || !client.retro_serialize(data, size))
+    return false;
+
+  m_bSerialized = true;
+
+  return true;
+}
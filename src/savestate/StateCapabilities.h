@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  class CLibretroDLL;
+
+  /*!
+   * \brief What the core's save states can be used for
+   *
+   * Built from the quirks reported with RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS.
+   * Everything in the add-on that saves states goes through this object,
+   * which also caches the state size of cores whose states have a fixed
+   * size.
+   */
+  class CStateCapabilities
+  {
+  public:
+    CStateCapabilities() = default;
+
+    /*!
+     * \brief Forget the quirks, e.g. when a new core is loaded
+     */
+    void Reset();
+
+    /*!
+     * \brief Forget what was learned while a game was loaded
+     */
+    void ResetSession();
+
+    /*!
+     * \brief Record the quirks reported by the core
+     *
+     * \param quirks Bitmask of RETRO_SERIALIZATION_QUIRK_* flags
+     *
+     * \return The quirks as acknowledged to the core: unknown flags are
+     *         cleared, and FRONT_VARIABLE_SIZE is set if the core's state
+     *         size is variable
+     */
+    uint64_t SetQuirks(uint64_t quirks);
+
+    uint64_t Quirks() const { return m_quirks; }
+
+    /*!
+     * \brief True if states are not reliable enough for frame-accurate
+     *        features, such as recording input movies
+     */
+    bool IsIncomplete() const;
+
+    /*!
+     * \brief True if saving states may fail until the core has run for a
+     *        while after loading the game
+     */
+    bool IsInitializing() const;
+
+    /*!
+     * \brief True if the state size may change while a game is loaded
+     */
+    bool IsVariableSize() const;
+
+    /*!
+     * \brief True if states can't be loaded after the game is reloaded
+     */
+    bool IsSingleSession() const;
+
+    /*!
+     * \brief True if states can be loaded on another machine
+     */
+    bool IsPortable() const;
+
+    /*!
+     * \brief Get the size of a state
+     *
+     * The size is only queried once for cores with fixed-size states. It
+     * is queried every time while the core is initializing, because the
+     * size may not be correct yet.
+     */
+    size_t SerializeSize(CLibretroDLL& client);
+
+    /*!
+     * \brief Save a state, keeping track of whether the core is initialized
+     */
+    bool Serialize(CLibretroDLL& client, uint8_t* data, size_t size);
+
+  private:
+    bool HasQuirk(uint64_t quirk) const { return (m_quirks & quirk) != 0; }
+
+    uint64_t m_quirks = 0;
+    bool m_bSerialized = false; // True once the core has saved a state
+    size_t m_cachedSize = 0;
+  };
+}
@@ -7,13 +7,66 @@
 
 #include "Settings.h"
 
+#include <algorithm>
+
 using namespace LIBRETRO;
 
-#define SETTING_CROP_OVERSCAN  "cropoverscan"
+#define SETTING_CROP_OVERSCAN    "cropoverscan"
+#define SETTING_FRAME_PROFILING  "frameprofiling"
+#define SETTING_DIRTY_PAGE_TRACKING "dirtypagetracking"
+#define SETTING_TRACK_VIDEO_CHANGES "trackvideochanges"
+#define SETTING_RUN_AHEAD_FRAMES "runaheadframes"
+#define SETTING_PREEMPTIVE_FRAMES "preemptiveframes"
+#define SETTING_FAST_FORWARD_RATIO "fastforwardratio"
+#define SETTING_FAST_FORWARD_BUDGET "fastforwardbudget"
+#define SETTING_MAX_FRAME_SKIP   "maxframeskip"
+#define SETTING_CONVERT_PIXEL_FORMAT "convertpixelformat"
+#define SETTING_SKIP_IDENTICAL_FRAMES "skipidenticalframes"
+#define SETTING_POST_PROCESS_FILTER "postprocessfilter"
+#define SETTING_POST_PROCESS_SCALE "postprocessscale"
+#define SETTING_INPUT_MOVIE      "inputmovie"
+#define SETTING_INPUT_MOVIE_FOLDER "inputmoviefolder"
+#define SETTING_MEDIA_CAPTURE    "mediacapture"
+#define SETTING_MEDIA_CAPTURE_FOLDER "mediacapturefolder"
+#define SETTING_CAPTURE_YUV      "captureyuv"
+#define SETTING_REPLAY_DURATION  "replayduration"
+#define SETTING_REPLAY_BUFFER_SIZE "replaybuffersize"
+#define SETTING_REWIND_BUFFER_SIZE "rewindbuffersize"
+#define SETTING_REWIND_INTERVAL  "rewindinterval"
+
+#define MAX_RUN_AHEAD_FRAMES  6
+#define MAX_FAST_FORWARD_RATIO  16
+#define MAX_FAST_FORWARD_BUDGET_MS  1000
+#define MAX_FRAME_SKIP  9
+#define MAX_POST_PROCESS_SCALE  4
+#define MAX_REPLAY_DURATION  120
+#define MIN_REPLAY_BUFFER_MB  16
+#define MAX_REPLAY_BUFFER_MB  512
+#define MAX_REWIND_BUFFER_MB  1024
+#define MAX_REWIND_INTERVAL  60
 
 CSettings::CSettings(void)
   : m_bInitialized(false),
-    m_bCropOverscan(false)
+    m_bCropOverscan(false),
+    m_bFrameProfiling(false),
+    m_bDirtyPageTracking(false),
+    m_bTrackVideoChanges(false),
+    m_runAheadFrames(0),
+    m_bPreemptiveFrames(false),
+    m_fastForwardRatio(1),
+    m_fastForwardBudgetMs(0),
+    m_maxFrameSkip(0),
+    m_bConvertPixelFormat(false),
+    m_bSkipIdenticalFrames(false),
+    m_postProcessFilter(VIDEO_FILTER_NONE),
+    m_postProcessScale(2),
+    m_inputMovieMode(INPUT_MOVIE_OFF),
+    m_bMediaCapture(false),
+    m_bCaptureYUV(false),
+    m_replayDuration(0),
+    m_replayBufferMB(128),
+    m_rewindBufferMB(0),
+    m_rewindInterval(1)
 {
 }
 
@@ -30,6 +83,124 @@ void CSettings::SetSetting(const std::string& strName, const kodi::addon::CSetti
     m_bCropOverscan = value.GetBoolean();
     //dsyslog("Setting \"%s\" set to %f", SETTING_CROP_OVERSCAN, m_bCropOverscan ? "true" : "false");
   }
+  else if (strName == SETTING_FRAME_PROFILING)
+  {
+    m_bFrameProfiling = value.GetBoolean();
+  }
+  else if (strName == SETTING_DIRTY_PAGE_TRACKING)
+  {
+    m_bDirtyPageTracking = value.GetBoolean();
+  }
+  else if (strName == SETTING_TRACK_VIDEO_CHANGES)
+  {
+    m_bTrackVideoChanges = value.GetBoolean();
+  }
+  else if (strName == SETTING_RUN_AHEAD_FRAMES)
+  {
+    const int frames = value.GetInt();
+    m_runAheadFrames = static_cast<unsigned int>(std::max(0, std::min(MAX_RUN_AHEAD_FRAMES, frames)));
+  }
+  else if (strName == SETTING_PREEMPTIVE_FRAMES)
+  {
+    m_bPreemptiveFrames = value.GetBoolean();
+  }
+  else if (strName == SETTING_FAST_FORWARD_RATIO)
+  {
+    const int ratio = value.GetInt();
+    m_fastForwardRatio = static_cast<unsigned int>(std::max(1, std::min(MAX_FAST_FORWARD_RATIO, ratio)));
+  }
+  else if (strName == SETTING_FAST_FORWARD_BUDGET)
+  {
+    const int budgetMs = value.GetInt();
+    m_fastForwardBudgetMs = static_cast<unsigned int>(std::max(0, std::min(MAX_FAST_FORWARD_BUDGET_MS, budgetMs)));
+  }
+  else if (strName == SETTING_MAX_FRAME_SKIP)
+  {
+    const int frames = value.GetInt();
+    m_maxFrameSkip = static_cast<unsigned int>(std::max(0, std::min(MAX_FRAME_SKIP, frames)));
+  }
+  else if (strName == SETTING_CONVERT_PIXEL_FORMAT)
+  {
+    m_bConvertPixelFormat = value.GetBoolean();
+  }
+  else if (strName == SETTING_SKIP_IDENTICAL_FRAMES)
+  {
+    m_bSkipIdenticalFrames = value.GetBoolean();
+  }
+  else if (strName == SETTING_POST_PROCESS_FILTER)
+  {
+    switch (value.GetInt())
+    {
+    case VIDEO_FILTER_NEAREST:
+      m_postProcessFilter = VIDEO_FILTER_NEAREST;
+      break;
+    case VIDEO_FILTER_SCALE2X:
+      m_postProcessFilter = VIDEO_FILTER_SCALE2X;
+      break;
+    case VIDEO_FILTER_BILINEAR:
+      m_postProcessFilter = VIDEO_FILTER_BILINEAR;
+      break;
+    default:
+      m_postProcessFilter = VIDEO_FILTER_NONE;
+      break;
+    }
+  }
+  else if (strName == SETTING_POST_PROCESS_SCALE)
+  {
+    const int scale = value.GetInt();
+    m_postProcessScale = static_cast<unsigned int>(std::max(2, std::min(MAX_POST_PROCESS_SCALE, scale)));
+  }
+  else if (strName == SETTING_INPUT_MOVIE)
+  {
+    switch (value.GetInt())
+    {
+    case INPUT_MOVIE_RECORD:
+      m_inputMovieMode = INPUT_MOVIE_RECORD;
+      break;
+    case INPUT_MOVIE_PLAYBACK:
+      m_inputMovieMode = INPUT_MOVIE_PLAYBACK;
+      break;
+    default:
+      m_inputMovieMode = INPUT_MOVIE_OFF;
+      break;
+    }
+  }
+  else if (strName == SETTING_INPUT_MOVIE_FOLDER)
+  {
+    m_strInputMovieFolder = value.GetString();
+  }
+  else if (strName == SETTING_MEDIA_CAPTURE)
+  {
+    m_bMediaCapture = value.GetBoolean();
+  }
+  else if (strName == SETTING_MEDIA_CAPTURE_FOLDER)
+  {
+    m_strMediaCaptureFolder = value.GetString();
+  }
+  else if (strName == SETTING_CAPTURE_YUV)
+  {
+    m_bCaptureYUV = value.GetBoolean();
+  }
+  else if (strName == SETTING_REPLAY_DURATION)
+  {
+    const int seconds = value.GetInt();
+    m_replayDuration = static_cast<unsigned int>(std::max(0, std::min(MAX_REPLAY_DURATION, seconds)));
+  }
+  else if (strName == SETTING_REPLAY_BUFFER_SIZE)
+  {
+    const int sizeMB = value.GetInt();
+    m_replayBufferMB = static_cast<unsigned int>(std::max(MIN_REPLAY_BUFFER_MB, std::min(MAX_REPLAY_BUFFER_MB, sizeMB)));
+  }
+  else if (strName == SETTING_REWIND_BUFFER_SIZE)
+  {
+    const int sizeMB = value.GetInt();
+    m_rewindBufferMB = static_cast<unsigned int>(std::max(0, std::min(MAX_REWIND_BUFFER_MB, sizeMB)));
+  }
+  else if (strName == SETTING_REWIND_INTERVAL)
+  {
+    const int frames = value.GetInt();
+    m_rewindInterval = static_cast<unsigned int>(std::max(1, std::min(MAX_REWIND_INTERVAL, frames)));
+  }
 
   m_bInitialized = true;
 }
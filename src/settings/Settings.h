@@ -12,6 +12,21 @@
 
 namespace LIBRETRO
 {
+  enum INPUT_MOVIE_MODE
+  {
+    INPUT_MOVIE_OFF = 0,
+    INPUT_MOVIE_RECORD,
+    INPUT_MOVIE_PLAYBACK,
+  };
+
+  enum VIDEO_FILTER
+  {
+    VIDEO_FILTER_NONE = 0,
+    VIDEO_FILTER_NEAREST,
+    VIDEO_FILTER_SCALE2X,
+    VIDEO_FILTER_BILINEAR,
+  };
+
   class CSettings
   {
   private:
@@ -29,8 +44,146 @@ namespace LIBRETRO
      */
     bool CropOverscan(void) const { return m_bCropOverscan; }
 
+    /*!
+     * \brief True if per-frame timing statistics should be collected
+     */
+    bool FrameProfiling(void) const { return m_bFrameProfiling; }
+
+    /*!
+     * \brief True if changes to the core's memory should be tracked per page
+     */
+    bool DirtyPageTracking(void) const { return m_bDirtyPageTracking; }
+
+    /*!
+     * \brief True if the changed regions of video frames should be tracked
+     */
+    bool TrackVideoChanges(void) const { return m_bTrackVideoChanges; }
+
+    /*!
+     * \brief Number of frames to run ahead to reduce input latency, or 0 if
+     *        run-ahead is disabled
+     */
+    unsigned int RunAheadFrames(void) const { return m_runAheadFrames; }
+
+    /*!
+     * \brief True if the run-ahead frames should only be re-emulated when
+     *        input changes, instead of every frame
+     */
+    bool PreemptiveFrames(void) const { return m_bPreemptiveFrames; }
+
+    /*!
+     * \brief Number of frames emulated per presented frame, or 1 if
+     *        fast-forward is disabled
+     */
+    unsigned int FastForwardRatio(void) const { return m_fastForwardRatio; }
+
+    /*!
+     * \brief Time in ms to fast-forward unthrottled per presented frame, or 0
+     *        to use the fast-forward ratio instead
+     */
+    unsigned int FastForwardBudgetMs(void) const { return m_fastForwardBudgetMs; }
+
+    /*!
+     * \brief Maximum number of consecutive frames whose video may be skipped
+     *        when the core is too slow, or 0 if frameskip is disabled
+     */
+    unsigned int MaxFrameSkip(void) const { return m_maxFrameSkip; }
+
+    /*!
+     * \brief True if 16-bit video frames should be converted to 32-bit in
+     *        the add-on
+     */
+    bool ConvertPixelFormat(void) const { return m_bConvertPixelFormat; }
+
+    /*!
+     * \brief True if video frames identical to the previous frame should not
+     *        be sent to Kodi
+     */
+    bool SkipIdenticalFrames(void) const { return m_bSkipIdenticalFrames; }
+
+    /*!
+     * \brief CPU filter used to scale video in the add-on, or
+     *        VIDEO_FILTER_NONE to leave scaling to Kodi
+     */
+    VIDEO_FILTER PostProcessFilter(void) const { return m_postProcessFilter; }
+
+    /*!
+     * \brief Scale factor of the video filter
+     */
+    unsigned int PostProcessScale(void) const { return m_postProcessScale; }
+
+    /*!
+     * \brief Whether input should be recorded to or played back from a
+     *        movie when a game is loaded
+     */
+    INPUT_MOVIE_MODE InputMovieMode(void) const { return m_inputMovieMode; }
+
+    /*!
+     * \brief Folder containing input movies, or empty to use the save folder
+     */
+    const std::string& InputMovieFolder(void) const { return m_strInputMovieFolder; }
+
+    /*!
+     * \brief True if the game's video and audio should be written to disk
+     */
+    bool MediaCapture(void) const { return m_bMediaCapture; }
+
+    /*!
+     * \brief Folder for captured video and audio, or empty to use the save
+     *        folder
+     */
+    const std::string& MediaCaptureFolder(void) const { return m_strMediaCaptureFolder; }
+
+    /*!
+     * \brief True if captured and replayed video should be converted to YUV
+     *        for viewing, instead of keeping the RGB channels losslessly
+     */
+    bool CaptureYUV(void) const { return m_bCaptureYUV; }
+
+    /*!
+     * \brief Seconds of video and audio kept for instant replay, or 0 if
+     *        instant replay is disabled
+     */
+    unsigned int ReplayDuration(void) const { return m_replayDuration; }
+
+    /*!
+     * \brief Memory limit in MB of the instant replay buffer
+     */
+    unsigned int ReplayBufferMB(void) const { return m_replayBufferMB; }
+
+    /*!
+     * \brief Memory in MB for the rewind history, or 0 if rewind is disabled
+     */
+    unsigned int RewindBufferMB(void) const { return m_rewindBufferMB; }
+
+    /*!
+     * \brief Number of frames between states saved to the rewind history
+     */
+    unsigned int RewindInterval(void) const { return m_rewindInterval; }
+
   private:
-    bool  m_bInitialized;
-    bool  m_bCropOverscan;
+    bool          m_bInitialized;
+    bool          m_bCropOverscan;
+    bool          m_bFrameProfiling;
+    bool          m_bDirtyPageTracking;
+    bool          m_bTrackVideoChanges;
+    unsigned int  m_runAheadFrames;
+    bool          m_bPreemptiveFrames;
+    unsigned int  m_fastForwardRatio;
+    unsigned int  m_fastForwardBudgetMs;
+    unsigned int  m_maxFrameSkip;
+    bool          m_bConvertPixelFormat;
+    bool          m_bSkipIdenticalFrames;
+    VIDEO_FILTER  m_postProcessFilter;
+    unsigned int  m_postProcessScale;
+    INPUT_MOVIE_MODE m_inputMovieMode;
+    std::string   m_strInputMovieFolder;
+    bool          m_bMediaCapture;
+    std::string   m_strMediaCaptureFolder;
+    bool          m_bCaptureYUV;
+    unsigned int  m_replayDuration;
+    unsigned int  m_replayBufferMB;
+    unsigned int  m_rewindBufferMB;
+    unsigned int  m_rewindInterval;
   };
 }
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Crc32.h"
+
+#include <array>
+
+using namespace LIBRETRO;
+
+#define CRC32_POLYNOMIAL  0xedb88320u // Reversed
+
+namespace
+{
+  // Tables for processing four bytes at a time ("slicing-by-4")
+  using CrcTables = std::array<std::array<uint32_t, 256>, 4>;
+
+  CrcTables CreateTables()
+  {
+    CrcTables tables;
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t crc = i;
+      for (unsigned int bit = 0; bit < 8; bit++)
+        crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+      tables[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      for (unsigned int table = 1; table < tables.size(); table++)
+        tables[table][i] = (tables[table - 1][i] >> 8) ^ tables[0][tables[table - 1][i] & 0xff];
+    }
+
+    return tables;
+  }
+}
+
+uint32_t CCrc32::Compute(const uint8_t* data, size_t size, uint32_t crc)
+{
+  static const CrcTables tables = CreateTables();
+
+  crc = ~crc;
+
+  while (size >= 4)
+  {
+    crc ^= static_cast<uint32_t>(data[0]) |
+           static_cast<uint32_t>(data[1]) << 8 |
+           static_cast<uint32_t>(data[2]) << 16 |
+           static_cast<uint32_t>(data[3]) << 24;
+
+    crc = tables[3][crc & 0xff] ^
+          tables[2][(crc >> 8) & 0xff] ^
+          tables[1][(crc >> 16) & 0xff] ^
+          tables[0][crc >> 24];
+
+    data += 4;
+    size -= 4;
+  }
+
+  while (size-- > 0)
+    crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xff];
+
+  return ~crc;
+}
@@ -0,0 +1,31 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief CRC-32 (IEEE 802.3), as used by zlib and PNG
+   */
+  class CCrc32
+  {
+  public:
+    /*!
+     * \brief Compute the checksum of a buffer
+     *
+     * \param data The data
+     * \param size The size of the data
+     * \param crc The checksum of any preceding data, to checksum a stream
+     *        in pieces
+     */
+    static uint32_t Compute(const uint8_t* data, size_t size, uint32_t crc = 0);
+  };
+}
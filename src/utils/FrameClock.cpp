@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FrameClock.h"
+#include "log/Log.h"
+
+#include <cmath>
+
+using namespace LIBRETRO;
+
+// Weight of a new delta in the exponential moving average
+#define DELTA_SMOOTHING  0.125
+
+// Longer deltas are treated as a pause instead of a slow frame
+#define MAX_DELTA_USEC   250000
+
+int64_t CFrameClock::Tick(bool bThrottled)
+{
+  const uint64_t now = m_timer.microseconds();
+
+  if (m_lastTickUsec == 0)
+  {
+    // First frame. Nothing has been measured, so assume the ideal frame
+    // time.
+    m_lastTickUsec = now;
+    m_lastDeltaUsec = m_referenceUsec;
+
+    if (m_smoothedUsec <= 0.0)
+      m_smoothedUsec = static_cast<double>(m_referenceUsec);
+
+    return m_referenceUsec;
+  }
+
+  const int64_t delta = static_cast<int64_t>(now - m_lastTickUsec);
+  m_lastTickUsec = now;
+  m_lastDeltaUsec = delta;
+
+  if (delta <= MAX_DELTA_USEC)
+  {
+    m_deltas.Add(static_cast<uint64_t>(delta));
+
+    m_sampleCount++;
+    const double diff = delta - m_mean;
+    m_mean += diff / m_sampleCount;
+    m_m2 += diff * (delta - m_mean);
+
+    if (m_smoothedUsec <= 0.0)
+      m_smoothedUsec = static_cast<double>(delta);
+    else
+      m_smoothedUsec += (delta - m_smoothedUsec) * DELTA_SMOOTHING;
+  }
+
+  if (bThrottled && m_referenceUsec > 0)
+    return m_referenceUsec;
+
+  return static_cast<int64_t>(m_smoothedUsec + 0.5);
+}
+
+void CFrameClock::LogStatistics() const
+{
+  if (m_sampleCount < 2)
+    return;
+
+  const double stddev = std::sqrt(m_m2 / (m_sampleCount - 1));
+
+  isyslog("Frame clock over %llu frames (microseconds): mean: %.1f  jitter (stddev): %.1f  "
+          "p50: %llu  p99: %llu  max: %llu  reference: %lld",
+      static_cast<unsigned long long>(m_sampleCount),
+      m_mean,
+      stddev,
+      static_cast<unsigned long long>(m_deltas.Percentile(0.50)),
+      static_cast<unsigned long long>(m_deltas.Percentile(0.99)),
+      static_cast<unsigned long long>(m_deltas.Max()),
+      static_cast<long long>(m_referenceUsec));
+}
+
+void CFrameClock::Reset()
+{
+  m_lastTickUsec = 0;
+  m_lastDeltaUsec = 0;
+  m_smoothedUsec = 0.0;
+  m_deltas.Reset();
+  m_sampleCount = 0;
+  m_mean = 0.0;
+  m_m2 = 0.0;
+}
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Histogram.h"
+#include "Timer.h"
+
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Measures the time between frames for the frame time callback
+   *
+   * Raw deltas between frames are noisy, as they include the scheduling
+   * jitter of the frontend. Cores that advance their emulation by the frame
+   * time stutter when they receive them directly. This clock instead reports
+   * the ideal frame time of the core (its "reference") while the frame rate
+   * is throttled to the core's rate, and a smoothed delta otherwise. The
+   * raw deltas are kept to report jitter statistics.
+   *
+   * Kodi doesn't tell the add-on when the game is paused, it just stops
+   * running frames. Long gaps between frames are therefore treated as a
+   * pause and left out of the smoothed delta and the statistics.
+   *
+   * All times are in microseconds, the unit of retro_usec_t.
+   */
+  class CFrameClock
+  {
+  public:
+    CFrameClock() = default;
+
+    /*!
+     * \brief Set the ideal frame time requested by the core, or 0 if unknown
+     */
+    void SetReference(int64_t referenceUsec) { m_referenceUsec = referenceUsec; }
+
+    /*!
+     * \brief Advance the clock at the start of a frame
+     *
+     * \param bThrottled True if frames are presented at the core's rate,
+     *                   false if running faster, e.g. when fast-forwarding
+     *
+     * \return The frame time to report to the core
+     */
+    int64_t Tick(bool bThrottled);
+
+    int64_t LastDelta() const { return m_lastDeltaUsec; }
+    double SmoothedDelta() const { return m_smoothedUsec; }
+
+    /*!
+     * \brief Log the distribution of raw frame times and their jitter
+     */
+    void LogStatistics() const;
+
+    void Reset();
+
+  private:
+    Timer m_timer;
+    int64_t m_referenceUsec = 0;
+
+    // Clock state
+    uint64_t m_lastTickUsec = 0;
+    int64_t m_lastDeltaUsec = 0;
+    double m_smoothedUsec = 0.0;
+
+    // Statistics of the raw deltas, using Welford's algorithm for variance
+    CHistogram m_deltas;
+    uint64_t m_sampleCount = 0;
+    double m_mean = 0.0;
+    double m_m2 = 0.0;
+  };
+}
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FrameProfiler.h"
+#include "log/Log.h"
+
+#include <chrono>
+
+using namespace LIBRETRO;
+
+CFrameProfiler::CFrameProfiler() :
+  m_bEnabled(false)
+{
+  for (auto& phaseTime : m_currentFrame)
+    phaseTime.store(0, std::memory_order_relaxed);
+}
+
+CFrameProfiler& CFrameProfiler::Get()
+{
+  static CFrameProfiler _instance;
+  return _instance;
+}
+
+void CFrameProfiler::AddSample(FRAME_PHASE phase, uint64_t nanoseconds)
+{
+  m_currentFrame[phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void CFrameProfiler::OnFrameEnd()
+{
+  if (!IsEnabled())
+    return;
+
+  std::array<uint64_t, FRAME_PHASE_COUNT> frame;
+  for (unsigned int i = 0; i < FRAME_PHASE_COUNT; i++)
+    frame[i] = m_currentFrame[i].exchange(0, std::memory_order_relaxed);
+
+  // The core is timed around retro_run(), which includes the callbacks into
+  // the frontend. Subtract them so the two can be told apart.
+  const uint64_t frontendTime = frame[FRAME_PHASE_VIDEO] + frame[FRAME_PHASE_AUDIO] + frame[FRAME_PHASE_INPUT];
+  frame[FRAME_PHASE_CORE] = frame[FRAME_PHASE_CORE] > frontendTime ? frame[FRAME_PHASE_CORE] - frontendTime : 0;
+
+  for (unsigned int i = 0; i < FRAME_PHASE_COUNT; i++)
+    m_histograms[i].Add(frame[i]);
+}
+
+void CFrameProfiler::LogStatistics() const
+{
+  if (m_histograms[FRAME_PHASE_FRAME].Count() == 0)
+    return;
+
+  isyslog("Frame timing over %llu frames (microseconds):",
+      static_cast<unsigned long long>(m_histograms[FRAME_PHASE_FRAME].Count()));
+
+  for (unsigned int i = 0; i < FRAME_PHASE_COUNT; i++)
+  {
+    const CHistogram& histogram = m_histograms[i];
+
+    isyslog("  %-5s p50: %8.1f  p99: %8.1f  max: %8.1f",
+        PhaseToString(static_cast<FRAME_PHASE>(i)),
+        histogram.Percentile(0.50) / 1000.0,
+        histogram.Percentile(0.99) / 1000.0,
+        histogram.Max() / 1000.0);
+  }
+}
+
+void CFrameProfiler::Reset()
+{
+  for (auto& phaseTime : m_currentFrame)
+    phaseTime.store(0, std::memory_order_relaxed);
+
+  for (auto& histogram : m_histograms)
+    histogram.Reset();
+}
+
+uint64_t CFrameProfiler::Now()
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+const char* CFrameProfiler::PhaseToString(FRAME_PHASE phase)
+{
+  switch (phase)
+  {
+  case FRAME_PHASE_FRAME: return "frame";
+  case FRAME_PHASE_CORE:  return "core";
+  case FRAME_PHASE_VIDEO: return "video";
+  case FRAME_PHASE_AUDIO: return "audio";
+  case FRAME_PHASE_INPUT: return "input";
+  default:
+    break;
+  }
+  return "";
+}
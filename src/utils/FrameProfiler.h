@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Histogram.h"
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  enum FRAME_PHASE
+  {
+    FRAME_PHASE_FRAME, // Everything done in RunFrame()
+    FRAME_PHASE_CORE,  // Time spent in retro_run(), excluding the frontend callbacks below
+    FRAME_PHASE_VIDEO, // Video submission
+    FRAME_PHASE_AUDIO, // Audio submission
+    FRAME_PHASE_INPUT, // Input queries
+    FRAME_PHASE_COUNT,
+  };
+
+  /*!
+   * \brief Per-frame timing of the phases of the frame loop
+   *
+   * Time spent in each phase is accumulated over a frame and recorded into a
+   * histogram when the frame ends, giving p50/p99/max statistics per phase
+   * for the session. Recording is lock-free, so phases can be timed from any
+   * thread.
+   */
+  class CFrameProfiler
+  {
+  private:
+    CFrameProfiler();
+
+  public:
+    static CFrameProfiler& Get();
+
+    void SetEnabled(bool bEnabled) { m_bEnabled.store(bEnabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+    /*!
+     * \brief Add time spent in a phase to the current frame
+     */
+    void AddSample(FRAME_PHASE phase, uint64_t nanoseconds);
+
+    /*!
+     * \brief Record the accumulated phase times of the current frame
+     */
+    void OnFrameEnd();
+
+    /*!
+     * \brief Write the collected statistics to the log
+     */
+    void LogStatistics() const;
+
+    void Reset();
+
+    /*!
+     * \brief Get a monotonic timestamp in nanoseconds
+     */
+    static uint64_t Now();
+
+    static const char* PhaseToString(FRAME_PHASE phase);
+
+  private:
+    std::atomic<bool> m_bEnabled;
+    std::array<std::atomic<uint64_t>, FRAME_PHASE_COUNT> m_currentFrame;
+    std::array<CHistogram, FRAME_PHASE_COUNT> m_histograms;
+  };
+
+  /*!
+   * \brief Times a scope and adds it to a phase of the current frame
+   */
+  class CFrameTimer
+  {
+  public:
+    CFrameTimer(FRAME_PHASE phase) :
+      m_phase(phase),
+      m_start(CFrameProfiler::Get().IsEnabled() ? CFrameProfiler::Now() : 0)
+    {
+    }
+
+    ~CFrameTimer()
+    {
+      if (m_start != 0)
+        CFrameProfiler::Get().AddSample(m_phase, CFrameProfiler::Now() - m_start);
+    }
+
+  private:
+    const FRAME_PHASE m_phase;
+    const uint64_t m_start;
+  };
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Histogram.h"
+
+#include <algorithm>
+
+using namespace LIBRETRO;
+
+CHistogram::CHistogram()
+{
+  Reset();
+}
+
+void CHistogram::Add(uint64_t value)
+{
+  value = std::min<uint64_t>(value, UINT32_MAX);
+
+  m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+  {
+  }
+}
+
+void CHistogram::Reset()
+{
+  for (auto& bucket : m_buckets)
+    bucket.store(0, std::memory_order_relaxed);
+
+  m_count.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CHistogram::Percentile(double fraction) const
+{
+  uint64_t total = 0;
+  for (const auto& bucket : m_buckets)
+    total += bucket.load(std::memory_order_relaxed);
+
+  if (total == 0)
+    return 0;
+
+  fraction = std::max(0.0, std::min(1.0, fraction));
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total + 0.5));
+
+  uint64_t seen = 0;
+  for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank)
+      return std::min(BucketUpperBound(i), Max());
+  }
+
+  return Max();
+}
+
+unsigned int CHistogram::BucketIndex(uint64_t value)
+{
+  if (value < LINEAR_BUCKETS)
+    return static_cast<unsigned int>(value);
+
+  unsigned int highestBit = 0;
+  while ((value >> (highestBit + 1)) != 0)
+    highestBit++;
+
+  const unsigned int shift = highestBit - SUB_BUCKET_BITS;
+  const unsigned int subBucket = static_cast<unsigned int>(value >> shift) & (SUB_BUCKETS - 1);
+
+  return LINEAR_BUCKETS + (highestBit - 4) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t CHistogram::BucketUpperBound(unsigned int index)
+{
+  if (index < LINEAR_BUCKETS)
+    return index;
+
+  const unsigned int highestBit = 4 + (index - LINEAR_BUCKETS) / SUB_BUCKETS;
+  const unsigned int subBucket = (index - LINEAR_BUCKETS) % SUB_BUCKETS;
+  const unsigned int shift = highestBit - SUB_BUCKET_BITS;
+
+  const uint64_t lowerBound = static_cast<uint64_t>(SUB_BUCKETS + subBucket) << shift;
+
+  return lowerBound + (uint64_t{1} << shift) - 1;
+}
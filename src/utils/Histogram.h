@@ -0,0 +1,58 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Lock-free histogram with log-linear buckets
+   *
+   * Values below 16 are counted exactly. Above that, every power of two is
+   * split into 8 buckets, so percentiles are accurate to within 12.5%. Values
+   * are clamped to 32 bits.
+   *
+   * Samples can be added from any thread without locking.
+   */
+  class CHistogram
+  {
+  public:
+    CHistogram();
+
+    void Add(uint64_t value);
+    void Reset();
+
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+
+    /*!
+     * \brief Get the upper bound of the bucket containing the given percentile
+     *
+     * \param fraction The percentile, between 0.0 and 1.0
+     *
+     * \return The estimated value, or 0 if no samples have been added
+     */
+    uint64_t Percentile(double fraction) const;
+
+  private:
+    static unsigned int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(unsigned int index);
+
+    static constexpr unsigned int LINEAR_BUCKETS = 16;
+    static constexpr unsigned int SUB_BUCKET_BITS = 3;
+    static constexpr unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr unsigned int BUCKET_COUNT = LINEAR_BUCKETS + (32 - 4) * SUB_BUCKETS;
+
+    std::array<std::atomic<uint32_t>, BUCKET_COUNT> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_max;
+  };
+}
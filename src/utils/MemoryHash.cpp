@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "MemoryHash.h"
+
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define HASH_MULTIPLIER  0x9e3779b97f4a7c15ull // 2^64 / golden ratio
+
+uint64_t CMemoryHash::Compute(const uint8_t* data, size_t size, uint64_t seed)
+{
+  // Multiply-xorshift hash. Four independent lanes keep the multiplier
+  // busy, so the hash isn't limited by the latency of the multiplication.
+  uint64_t lanes[4] = { seed + size, seed + size + 1, seed + size + 2, seed + size + 3 };
+
+  size_t i = 0;
+  for (; i + sizeof(lanes) <= size; i += sizeof(lanes))
+  {
+    uint64_t words[4];
+    memcpy(words, data + i, sizeof(words));
+
+    for (unsigned int lane = 0; lane < 4; lane++)
+    {
+      lanes[lane] = (lanes[lane] ^ words[lane]) * HASH_MULTIPLIER;
+      lanes[lane] ^= lanes[lane] >> 32;
+    }
+  }
+
+  uint64_t hash = lanes[0] ^ (lanes[1] * 3) ^ (lanes[2] * 5) ^ (lanes[3] * 7);
+
+  for (; i < size; i++)
+    hash = (hash ^ data[i]) * HASH_MULTIPLIER;
+
+  return hash;
+}
@@ -0,0 +1,33 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Fast 64-bit hash for detecting changes to memory
+   *
+   * This is not a cryptographic hash, and it doesn't resist deliberate
+   * collisions. It runs close to memory bandwidth.
+   */
+  class CMemoryHash
+  {
+  public:
+    /*!
+     * \brief Compute the hash of a buffer
+     *
+     * \param data The data
+     * \param size The size of the data
+     * \param seed The hash of any preceding data, to hash a buffer in pieces
+     */
+    static uint64_t Compute(const uint8_t* data, size_t size, uint64_t seed = 0);
+  };
+}
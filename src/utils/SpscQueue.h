@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Bounded lock-free queue for one producer and one consumer thread
+   *
+   * Items live in a fixed ring of slots and are filled and read in place, so
+   * slots that own buffers (e.g. a std::vector) keep their capacity and the
+   * queue stops allocating once every slot has been used.
+   *
+   * The producer calls BeginPush(), fills the slot and calls EndPush(). The
+   * consumer calls Front(), reads the slot and calls Pop(). Neither side
+   * ever blocks.
+   */
+  template<typename T>
+  class CSpscQueue
+  {
+  public:
+    explicit CSpscQueue(size_t capacity) : m_slots(capacity + 1) { }
+
+    size_t Capacity() const { return m_slots.size() - 1; }
+
+    /*!
+     * \brief Get the next free slot
+     *
+     * \return The slot, or nullptr if the queue is full
+     */
+    T* BeginPush()
+    {
+      const size_t tail = m_tail.load(std::memory_order_relaxed);
+      if (Next(tail) == m_head.load(std::memory_order_acquire))
+        return nullptr;
+
+      return &m_slots[tail];
+    }
+
+    /*!
+     * \brief Publish the slot returned by BeginPush() to the consumer
+     */
+    void EndPush()
+    {
+      m_tail.store(Next(m_tail.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    /*!
+     * \brief Get the oldest item
+     *
+     * \return The item, or nullptr if the queue is empty
+     */
+    T* Front()
+    {
+      const size_t head = m_head.load(std::memory_order_relaxed);
+      if (head == m_tail.load(std::memory_order_acquire))
+        return nullptr;
+
+      return &m_slots[head];
+    }
+
+    /*!
+     * \brief Return the slot returned by Front() to the producer
+     */
+    void Pop()
+    {
+      m_head.store(Next(m_head.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+
+    /*!
+     * \brief Number of queued items, only exact when called from one of the
+     *        two threads while the other is idle
+     */
+    size_t Size() const
+    {
+      const size_t head = m_head.load(std::memory_order_acquire);
+      const size_t tail = m_tail.load(std::memory_order_acquire);
+      return tail >= head ? tail - head : tail + m_slots.size() - head;
+    }
+
+  private:
+    size_t Next(size_t index) const { return index + 1 == m_slots.size() ? 0 : index + 1; }
+
+    std::vector<T> m_slots;
+
+    // Read position, written by the consumer
+    std::atomic<size_t> m_head{0};
+
+    // Keeps the two positions out of the same cache line. Padding instead of
+    // alignas, which heap allocations don't respect before C++17.
+    char m_padding[64];
+
+    // Write position, written by the producer
+    std::atomic<size_t> m_tail{0};
+  };
+}
@@ -14,3 +14,9 @@ uint64_t Timer::microseconds()
   const auto currenttime = m_clock.now().time_since_epoch();
   return std::chrono::duration_cast<std::chrono::microseconds>(currenttime).count();
 }
+
+uint64_t Timer::nanoseconds()
+{
+  const auto currenttime = m_clock.now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(currenttime).count();
+}
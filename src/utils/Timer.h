@@ -14,6 +14,10 @@ namespace LIBRETRO
 {
   /*!
    * \brief Utility to get the current time.
+   *
+   * The time is taken from a monotonic clock, so it never jumps when the
+   * system time is adjusted. It is only meaningful relative to other
+   * readings.
    */
   class Timer
   {
@@ -23,7 +27,12 @@ namespace LIBRETRO
      */
     uint64_t microseconds();
 
+    /*!
+     * \brief Returns current time in nanoseconds.
+     */
+    uint64_t nanoseconds();
+
   private:
-    std::chrono::high_resolution_clock m_clock;
+    std::chrono::steady_clock m_clock;
   };
 }
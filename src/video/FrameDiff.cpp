@@ -0,0 +1,206 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "FrameDiff.h"
+#include "log/Log.h"
+#include "utils/FrameProfiler.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define FRAME_DIFF_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define FRAME_DIFF_NEON
+#endif
+
+using namespace LIBRETRO;
+
+#define DIFF_TILE_SIZE  16 // Pixels
+
+namespace
+{
+  /*!
+   * \brief Compare two spans of the same row, 16 bytes at a time
+   *
+   * Tile rows are short (32 or 64 bytes), so differences are accumulated
+   * instead of branching on every vector.
+   */
+  bool SpansEqual(const uint8_t* a, const uint8_t* b, size_t size)
+  {
+    size_t i = 0;
+
+#if defined(FRAME_DIFF_SSE2)
+    __m128i diff = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+    {
+      diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff)
+      return false;
+#elif defined(FRAME_DIFF_NEON)
+    uint8x16_t diff = vdupq_n_u8(0);
+    for (; i + 16 <= size; i += 16)
+      diff = vorrq_u8(diff, veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+    if (vmaxvq_u8(diff) != 0)
+      return false;
+#endif
+
+    return memcmp(a + i, b + i, size - i) == 0;
+  }
+}
+
+void CFrameDiff::Reset()
+{
+  m_bHasPrevious = false;
+}
+
+void CFrameDiff::Deinitialize()
+{
+  Reset();
+
+  m_previous.clear();
+  m_previous.shrink_to_fit();
+  m_dirtyTiles.clear();
+  m_dirtyTiles.shrink_to_fit();
+}
+
+void CFrameDiff::Compare(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, unsigned int bytesPerPixel)
+{
+  const int64_t startNs = CFrameProfiler::Now();
+
+  const size_t rowSize = static_cast<size_t>(width) * bytesPerPixel;
+
+  // A different frame layout can't be compared, so everything is dirty
+  const bool bCompare = m_bHasPrevious && width == m_width && height == m_height && bytesPerPixel == m_bytesPerPixel;
+
+  m_width = width;
+  m_height = height;
+  m_bytesPerPixel = bytesPerPixel;
+  m_previous.resize(rowSize * height);
+
+  m_tileColumns = (width + DIFF_TILE_SIZE - 1) / DIFF_TILE_SIZE;
+  m_tileRows = (height + DIFF_TILE_SIZE - 1) / DIFF_TILE_SIZE;
+  m_dirtyTiles.assign(static_cast<size_t>(m_tileColumns) * m_tileRows, bCompare ? 0 : 1);
+
+  const size_t tileRowSize = static_cast<size_t>(DIFF_TILE_SIZE) * bytesPerPixel;
+
+  for (unsigned int y = 0; y < height; y++)
+  {
+    const uint8_t* source = data + y * pitch;
+    uint8_t* previous = m_previous.data() + y * rowSize;
+
+    if (!bCompare)
+    {
+      memcpy(previous, source, rowSize);
+      continue;
+    }
+
+    uint8_t* dirtyTiles = m_dirtyTiles.data() + (y / DIFF_TILE_SIZE) * m_tileColumns;
+
+    for (unsigned int column = 0; column < m_tileColumns; column++)
+    {
+      const size_t offset = column * tileRowSize;
+      const size_t size = std::min(tileRowSize, rowSize - offset);
+
+      // Only changed spans are copied, which keeps the copy cheap when
+      // little changes
+      if (!SpansEqual(source + offset, previous + offset, size))
+      {
+        memcpy(previous + offset, source + offset, size);
+        dirtyTiles[column] = 1;
+      }
+    }
+  }
+
+  m_bHasPrevious = true;
+
+  // Bounding rectangle and changed area
+  unsigned int minColumn = m_tileColumns;
+  unsigned int maxColumn = 0;
+  unsigned int minRow = m_tileRows;
+  unsigned int maxRow = 0;
+  uint64_t changedPixels = 0;
+
+  m_dirtyTileCount = 0;
+
+  for (unsigned int row = 0; row < m_tileRows; row++)
+  {
+    for (unsigned int column = 0; column < m_tileColumns; column++)
+    {
+      if (!IsTileDirty(column, row))
+        continue;
+
+      minColumn = std::min(minColumn, column);
+      maxColumn = std::max(maxColumn, column);
+      minRow = std::min(minRow, row);
+      maxRow = std::max(maxRow, row);
+
+      const unsigned int tileWidth = std::min(static_cast<unsigned int>(DIFF_TILE_SIZE), width - column * DIFF_TILE_SIZE);
+      const unsigned int tileHeight = std::min(static_cast<unsigned int>(DIFF_TILE_SIZE), height - row * DIFF_TILE_SIZE);
+      changedPixels += tileWidth * tileHeight;
+
+      m_dirtyTileCount++;
+    }
+  }
+
+  m_dirtyBounds = VideoRect{};
+  if (m_dirtyTileCount > 0)
+  {
+    m_dirtyBounds.x = minColumn * DIFF_TILE_SIZE;
+    m_dirtyBounds.y = minRow * DIFF_TILE_SIZE;
+    m_dirtyBounds.width = std::min((maxColumn + 1) * DIFF_TILE_SIZE, width) - m_dirtyBounds.x;
+    m_dirtyBounds.height = std::min((maxRow + 1) * DIFF_TILE_SIZE, height) - m_dirtyBounds.y;
+  }
+
+  // Statistics only cover frames that could be compared
+  if (bCompare)
+  {
+    m_compareNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+
+    const uint64_t totalPixels = static_cast<uint64_t>(width) * height;
+    const uint64_t permille = totalPixels > 0 ? changedPixels * 1000 / totalPixels : 0;
+
+    m_changedPermille.Add(permille);
+    m_changedPermilleSum += permille;
+    if (m_dirtyTileCount == 0)
+      m_unchangedFrames++;
+  }
+}
+
+unsigned int CFrameDiff::TileSize() const
+{
+  return DIFF_TILE_SIZE;
+}
+
+void CFrameDiff::LogStatistics() const
+{
+  const uint64_t frames = m_changedPermille.Count();
+  if (frames == 0)
+    return;
+
+  isyslog("Video changes: %llu frames compared, %llu unchanged, avg compare %.1f us",
+      static_cast<unsigned long long>(frames), static_cast<unsigned long long>(m_unchangedFrames),
+      m_compareNs / 1000.0 / frames);
+  isyslog("Video changes: changed area avg %.1f%%  p50: %.1f%%  p90: %.1f%%  p99: %.1f%% (%ux%u tiles)",
+      m_changedPermilleSum / 10.0 / frames,
+      m_changedPermille.Percentile(0.5) / 10.0,
+      m_changedPermille.Percentile(0.9) / 10.0,
+      m_changedPermille.Percentile(0.99) / 10.0,
+      DIFF_TILE_SIZE, DIFF_TILE_SIZE);
+}
+
+void CFrameDiff::ResetStatistics()
+{
+  m_changedPermille.Reset();
+  m_changedPermilleSum = 0;
+  m_unchangedFrames = 0;
+  m_compareNs = 0;
+}
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "utils/Histogram.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Rectangle in pixels
+   */
+  struct VideoRect
+  {
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+  };
+
+  /*!
+   * \brief Finds the parts of a software frame that changed since the
+   *        previous frame
+   *
+   * The frame is divided into square tiles. Each tile is compared with a
+   * copy of the previous frame, and only tiles that changed are copied into
+   * it. The result is a map of dirty tiles and their bounding rectangle.
+   */
+  class CFrameDiff
+  {
+  public:
+    CFrameDiff() = default;
+
+    /*!
+     * \brief Forget the previous frame, so the next frame is fully dirty
+     */
+    void Reset();
+
+    /*!
+     * \brief Free the copy of the previous frame
+     */
+    void Deinitialize();
+
+    /*!
+     * \brief Compare a frame with the previous one and keep it for the next
+     *        comparison
+     *
+     * \param data The frame
+     * \param width The width in pixels
+     * \param height The height in pixels
+     * \param pitch The distance between rows, in bytes
+     * \param bytesPerPixel The size of a pixel
+     */
+    void Compare(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, unsigned int bytesPerPixel);
+
+    /*!
+     * \brief The tile grid of the last compared frame
+     */
+    unsigned int TileSize() const;
+    unsigned int TileColumns() const { return m_tileColumns; }
+    unsigned int TileRows() const { return m_tileRows; }
+    bool IsTileDirty(unsigned int column, unsigned int row) const { return m_dirtyTiles[row * m_tileColumns + column] != 0; }
+    unsigned int DirtyTileCount() const { return m_dirtyTileCount; }
+
+    /*!
+     * \brief Bounding rectangle of the dirty tiles, empty if nothing changed
+     */
+    const VideoRect& DirtyBounds() const { return m_dirtyBounds; }
+
+    void LogStatistics() const;
+    void ResetStatistics();
+
+  private:
+    // Previous frame, without row padding
+    std::vector<uint8_t> m_previous;
+    unsigned int m_width = 0;
+    unsigned int m_height = 0;
+    unsigned int m_bytesPerPixel = 0;
+    bool m_bHasPrevious = false;
+
+    // Result of the last comparison
+    std::vector<uint8_t> m_dirtyTiles;
+    unsigned int m_tileColumns = 0;
+    unsigned int m_tileRows = 0;
+    unsigned int m_dirtyTileCount = 0;
+    VideoRect m_dirtyBounds;
+
+    // Statistics
+    CHistogram m_changedPermille; // Fraction of pixels in dirty tiles
+    uint64_t m_changedPermilleSum = 0;
+    uint64_t m_unchangedFrames = 0;
+    uint64_t m_compareNs = 0;
+  };
+}
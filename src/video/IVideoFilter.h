@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief A 0RGB8888 frame in memory owned by someone else
+   */
+  struct VideoFrame
+  {
+    uint8_t* data = nullptr;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    size_t pitch = 0;
+
+    uint32_t* Row(unsigned int y) const { return reinterpret_cast<uint32_t*>(data + y * pitch); }
+  };
+
+  /*!
+   * \brief A CPU video filter that scales 0RGB8888 frames
+   */
+  class IVideoFilter
+  {
+  public:
+    virtual ~IVideoFilter(void) { }
+
+    virtual const char* Name() const = 0;
+
+    /*!
+     * \brief The output size, as a multiple of the input size
+     */
+    virtual unsigned int Scale() const = 0;
+
+    /*!
+     * \brief Filter a range of source rows into the matching target rows
+     *
+     * May be called from several threads at once for disjoint row ranges.
+     * Filters can read any row of the source, but only write their own
+     * rows of the target.
+     *
+     * \param source The input frame
+     * \param target The output frame, Scale() times the size of the input
+     * \param rowBegin The first source row
+     * \param rowEnd One past the last source row
+     */
+    virtual void Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const = 0;
+  };
+}
@@ -0,0 +1,393 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "PixelConverter.h"
+#include "libretro/CpuFeatures.h"
+#include "libretro-common/libretro.h"
+#include "log/Log.h"
+#include "utils/FrameProfiler.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+  #include <immintrin.h>
+  #define PIXEL_CONVERTER_X86
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #define TARGET_SSE2
+    #define TARGET_AVX2
+  #else
+    // Kernels are compiled for their instruction set regardless of the
+    // build flags, and only called if the CPU supports it
+    #define TARGET_SSE2  __attribute__((target("sse2")))
+    #define TARGET_AVX2  __attribute__((target("avx2")))
+  #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define PIXEL_CONVERTER_NEON
+#endif
+
+using namespace LIBRETRO;
+
+#define ROW_ALIGNMENT  64 // Cache line
+
+namespace
+{
+  // Bit layouts of the source formats
+  enum SOURCE_FORMAT
+  {
+    SOURCE_RGB565,   // RRRRRGGG GGGBBBBB
+    SOURCE_0RGB1555, // 0RRRRRGG GGGBBBBB
+  };
+
+  //
+  // Scalar reference implementation
+  //
+  // Channels are expanded by replicating their high bits into the new low
+  // bits, so that full intensity maps to 0xff. Output is 0RGB8888 in native
+  // endian, i.e. bytes B, G, R, 0 on little endian hosts.
+  //
+
+  template<SOURCE_FORMAT format>
+  inline uint32_t ConvertPixel(uint16_t pixel)
+  {
+    uint32_t r, g, b;
+
+    if (format == SOURCE_RGB565)
+    {
+      r = (pixel >> 11) & 0x1f;
+      g = (pixel >> 5) & 0x3f;
+      b = pixel & 0x1f;
+      g = (g << 2) | (g >> 4);
+    }
+    else
+    {
+      r = (pixel >> 10) & 0x1f;
+      g = (pixel >> 5) & 0x1f;
+      b = pixel & 0x1f;
+      g = (g << 3) | (g >> 2);
+    }
+
+    r = (r << 3) | (r >> 2);
+    b = (b << 3) | (b >> 2);
+
+    return (r << 16) | (g << 8) | b;
+  }
+
+  template<SOURCE_FORMAT format>
+  void ConvertRowScalar(const uint16_t* source, uint32_t* target, unsigned int width)
+  {
+    for (unsigned int x = 0; x < width; x++)
+      target[x] = ConvertPixel<format>(source[x]);
+  }
+
+#if defined(PIXEL_CONVERTER_X86)
+  //
+  // SSE2: 8 pixels per iteration
+  //
+  // Channels are expanded in 16-bit lanes. Interleaving the B|G<<8 words
+  // with the R words then yields the 32-bit pixels.
+  //
+
+  template<SOURCE_FORMAT format>
+  TARGET_SSE2 void ConvertRowSSE2(const uint16_t* source, uint32_t* target, unsigned int width)
+  {
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+
+      __m128i r, g;
+      if (format == SOURCE_RGB565)
+      {
+        r = _mm_srli_epi16(pixels, 11);
+        g = _mm_and_si128(_mm_srli_epi16(pixels, 5), mask6);
+        g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+      }
+      else
+      {
+        r = _mm_and_si128(_mm_srli_epi16(pixels, 10), mask5);
+        g = _mm_and_si128(_mm_srli_epi16(pixels, 5), mask5);
+        g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+      }
+      __m128i b = _mm_and_si128(pixels, mask5);
+
+      r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+      b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+      const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+
+      _mm_store_si128(reinterpret_cast<__m128i*>(target + x), _mm_unpacklo_epi16(bg, r));
+      _mm_store_si128(reinterpret_cast<__m128i*>(target + x + 4), _mm_unpackhi_epi16(bg, r));
+    }
+
+    ConvertRowScalar<format>(source + x, target + x, width - x);
+  }
+
+  //
+  // AVX2: 16 pixels per iteration
+  //
+  // Same as SSE2, but interleaving works within 128-bit halves, so the
+  // halves are put back in order before storing.
+  //
+
+  template<SOURCE_FORMAT format>
+  TARGET_AVX2 void ConvertRowAVX2(const uint16_t* source, uint32_t* target, unsigned int width)
+  {
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    const __m256i mask6 = _mm256_set1_epi16(0x3f);
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + x));
+
+      __m256i r, g;
+      if (format == SOURCE_RGB565)
+      {
+        r = _mm256_srli_epi16(pixels, 11);
+        g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5), mask6);
+        g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+      }
+      else
+      {
+        r = _mm256_and_si256(_mm256_srli_epi16(pixels, 10), mask5);
+        g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5), mask5);
+        g = _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+      }
+      __m256i b = _mm256_and_si256(pixels, mask5);
+
+      r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+      b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+      const __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+
+      const __m256i low = _mm256_unpacklo_epi16(bg, r);  // Pixels 0-3, 8-11
+      const __m256i high = _mm256_unpackhi_epi16(bg, r); // Pixels 4-7, 12-15
+
+      _mm256_store_si256(reinterpret_cast<__m256i*>(target + x), _mm256_permute2x128_si256(low, high, 0x20));
+      _mm256_store_si256(reinterpret_cast<__m256i*>(target + x + 8), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+
+    ConvertRowScalar<format>(source + x, target + x, width - x);
+  }
+#endif
+
+#if defined(PIXEL_CONVERTER_NEON)
+  //
+  // NEON: 8 pixels per iteration
+  //
+  // Channels are expanded in 16-bit lanes, narrowed to bytes and written
+  // with an interleaving store.
+  //
+
+  template<SOURCE_FORMAT format>
+  void ConvertRowNEON(const uint16_t* source, uint32_t* target, unsigned int width)
+  {
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+
+    uint8x8x4_t bgrx;
+    bgrx.val[3] = vdup_n_u8(0);
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      const uint16x8_t pixels = vld1q_u16(source + x);
+
+      uint16x8_t r, g;
+      if (format == SOURCE_RGB565)
+      {
+        r = vshrq_n_u16(pixels, 11);
+        g = vandq_u16(vshrq_n_u16(pixels, 5), mask6);
+        g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+      }
+      else
+      {
+        r = vandq_u16(vshrq_n_u16(pixels, 10), mask5);
+        g = vandq_u16(vshrq_n_u16(pixels, 5), mask5);
+        g = vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2));
+      }
+      uint16x8_t b = vandq_u16(pixels, mask5);
+
+      r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+      b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+
+      bgrx.val[0] = vmovn_u16(b);
+      bgrx.val[1] = vmovn_u16(g);
+      bgrx.val[2] = vmovn_u16(r);
+
+      vst4_u8(reinterpret_cast<uint8_t*>(target + x), bgrx);
+    }
+
+    ConvertRowScalar<format>(source + x, target + x, width - x);
+  }
+#endif
+}
+
+CPixelConverter::CPixelConverter() :
+  m_convertRGB565(ConvertRowScalar<SOURCE_RGB565>),
+  m_convert0RGB1555(ConvertRowScalar<SOURCE_0RGB1555>)
+{
+}
+
+void CPixelConverter::SelectKernel()
+{
+  static const PIXEL_KERNEL preferredKernels[] = {
+    PIXEL_KERNEL_AVX2,
+    PIXEL_KERNEL_SSE2,
+    PIXEL_KERNEL_NEON,
+  };
+
+  PIXEL_KERNEL kernel = PIXEL_KERNEL_SCALAR;
+
+  for (PIXEL_KERNEL preferredKernel : preferredKernels)
+  {
+    if (IsKernelSupported(preferredKernel))
+    {
+      kernel = preferredKernel;
+      break;
+    }
+  }
+
+  SetKernel(kernel);
+
+  dsyslog("Pixel conversion: using %s kernel", KernelName(m_kernel));
+}
+
+bool CPixelConverter::SetKernel(PIXEL_KERNEL kernel)
+{
+  if (!IsKernelSupported(kernel))
+    return false;
+
+  switch (kernel)
+  {
+#if defined(PIXEL_CONVERTER_X86)
+  case PIXEL_KERNEL_SSE2:
+    m_convertRGB565 = ConvertRowSSE2<SOURCE_RGB565>;
+    m_convert0RGB1555 = ConvertRowSSE2<SOURCE_0RGB1555>;
+    break;
+  case PIXEL_KERNEL_AVX2:
+    m_convertRGB565 = ConvertRowAVX2<SOURCE_RGB565>;
+    m_convert0RGB1555 = ConvertRowAVX2<SOURCE_0RGB1555>;
+    break;
+#endif
+#if defined(PIXEL_CONVERTER_NEON)
+  case PIXEL_KERNEL_NEON:
+    m_convertRGB565 = ConvertRowNEON<SOURCE_RGB565>;
+    m_convert0RGB1555 = ConvertRowNEON<SOURCE_0RGB1555>;
+    break;
+#endif
+  default:
+    m_convertRGB565 = ConvertRowScalar<SOURCE_RGB565>;
+    m_convert0RGB1555 = ConvertRowScalar<SOURCE_0RGB1555>;
+    break;
+  }
+
+  m_kernel = kernel;
+
+  return true;
+}
+
+bool CPixelConverter::IsKernelSupported(PIXEL_KERNEL kernel)
+{
+  switch (kernel)
+  {
+  case PIXEL_KERNEL_SCALAR:
+    return true;
+#if defined(PIXEL_CONVERTER_X86)
+  case PIXEL_KERNEL_SSE2:
+    return CCpuFeatures::Get().Has(RETRO_SIMD_SSE2);
+  case PIXEL_KERNEL_AVX2:
+    return CCpuFeatures::Get().Has(RETRO_SIMD_AVX2);
+#endif
+#if defined(PIXEL_CONVERTER_NEON)
+  case PIXEL_KERNEL_NEON:
+    return CCpuFeatures::Get().Has(RETRO_SIMD_NEON);
+#endif
+  default:
+    break;
+  }
+
+  return false;
+}
+
+const char* CPixelConverter::KernelName(PIXEL_KERNEL kernel)
+{
+  switch (kernel)
+  {
+  case PIXEL_KERNEL_SCALAR:
+    return "scalar";
+  case PIXEL_KERNEL_SSE2:
+    return "SSE2";
+  case PIXEL_KERNEL_AVX2:
+    return "AVX2";
+  case PIXEL_KERNEL_NEON:
+    return "NEON";
+  default:
+    break;
+  }
+
+  return "unknown";
+}
+
+void CPixelConverter::ConvertRGB565(const uint8_t* source, unsigned int width, unsigned int height, size_t pitch)
+{
+  Convert(m_convertRGB565, source, width, height, pitch);
+}
+
+void CPixelConverter::Convert0RGB1555(const uint8_t* source, unsigned int width, unsigned int height, size_t pitch)
+{
+  Convert(m_convert0RGB1555, source, width, height, pitch);
+}
+
+void CPixelConverter::Convert(RowFunction convertRow, const uint8_t* source, unsigned int width, unsigned int height, size_t pitch)
+{
+  const int64_t startNs = CFrameProfiler::Now();
+
+  m_pitch = (static_cast<size_t>(width) * 4 + ROW_ALIGNMENT - 1) & ~static_cast<size_t>(ROW_ALIGNMENT - 1);
+  m_height = height;
+
+  // The buffer only grows, so its address is stable once the largest frame
+  // has been seen
+  const size_t requiredSize = m_pitch * height + ROW_ALIGNMENT - 1;
+  if (m_storage.size() < requiredSize)
+  {
+    m_storage.resize(requiredSize);
+
+    const uintptr_t address = reinterpret_cast<uintptr_t>(m_storage.data());
+    m_data = m_storage.data() + ((ROW_ALIGNMENT - address % ROW_ALIGNMENT) % ROW_ALIGNMENT);
+  }
+
+  for (unsigned int y = 0; y < height; y++)
+  {
+    convertRow(reinterpret_cast<const uint16_t*>(source + y * pitch),
+               reinterpret_cast<uint32_t*>(m_data + y * m_pitch),
+               width);
+  }
+
+  m_elapsedNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+  m_pixels += static_cast<uint64_t>(width) * height;
+  m_frames++;
+}
+
+void CPixelConverter::LogStatistics() const
+{
+  if (m_frames == 0)
+    return;
+
+  isyslog("Pixel conversion (%s): %llu frames, avg %.1f us per frame, %.1f Mpixels/s",
+      KernelName(m_kernel), static_cast<unsigned long long>(m_frames), m_elapsedNs / 1000.0 / m_frames,
+      m_elapsedNs > 0 ? m_pixels * 1000.0 / m_elapsedNs : 0.0);
+}
+
+void CPixelConverter::ResetStatistics()
+{
+  m_frames = 0;
+  m_pixels = 0;
+  m_elapsedNs = 0;
+}
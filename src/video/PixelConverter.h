@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LIBRETRO
+{
+  enum PIXEL_KERNEL
+  {
+    PIXEL_KERNEL_SCALAR, // Reference implementation
+    PIXEL_KERNEL_SSE2,
+    PIXEL_KERNEL_AVX2,
+    PIXEL_KERNEL_NEON,
+    PIXEL_KERNEL_COUNT,
+  };
+
+  /*!
+   * \brief Converts 16-bit video frames to 0RGB8888
+   *
+   * Cores using RGB565 or 0RGB1555 can have their frames expanded in the
+   * add-on, on the emulation thread, instead of leaving the conversion to
+   * the host's render thread. Frames are written to a reusable buffer whose
+   * rows are 64-byte aligned.
+   *
+   * The conversion kernel is picked at runtime from the CPU features. All
+   * kernels produce exactly the same output as the scalar one.
+   */
+  class CPixelConverter
+  {
+  public:
+    CPixelConverter();
+
+    /*!
+     * \brief Use the fastest kernel supported by the CPU
+     *
+     * CCpuFeatures must have been detected first.
+     */
+    void SelectKernel();
+
+    /*!
+     * \brief Use a specific kernel, e.g. for benchmarking
+     *
+     * \return False if the kernel isn't supported by this build or CPU
+     */
+    bool SetKernel(PIXEL_KERNEL kernel);
+
+    PIXEL_KERNEL Kernel() const { return m_kernel; }
+
+    static bool IsKernelSupported(PIXEL_KERNEL kernel);
+    static const char* KernelName(PIXEL_KERNEL kernel);
+
+    /*!
+     * \brief Convert a frame to 0RGB8888
+     *
+     * \param source The frame
+     * \param width The width in pixels
+     * \param height The height in pixels
+     * \param pitch The distance between rows of the source, in bytes
+     */
+    void ConvertRGB565(const uint8_t* source, unsigned int width, unsigned int height, size_t pitch);
+    void Convert0RGB1555(const uint8_t* source, unsigned int width, unsigned int height, size_t pitch);
+
+    /*!
+     * \brief The last converted frame
+     */
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_pitch * m_height; }
+    size_t Pitch() const { return m_pitch; }
+
+    void LogStatistics() const;
+    void ResetStatistics();
+
+  private:
+    using RowFunction = void (*)(const uint16_t* source, uint32_t* target, unsigned int width);
+
+    void Convert(RowFunction convertRow, const uint8_t* source, unsigned int width, unsigned int height, size_t pitch);
+
+    // Conversion kernel
+    PIXEL_KERNEL m_kernel = PIXEL_KERNEL_SCALAR;
+    RowFunction m_convertRGB565;
+    RowFunction m_convert0RGB1555;
+
+    // Output buffer
+    std::vector<uint8_t> m_storage;
+    uint8_t* m_data = nullptr;
+    size_t m_pitch = 0;
+    unsigned int m_height = 0;
+
+    // Statistics
+    uint64_t m_frames = 0;
+    uint64_t m_pixels = 0;
+    uint64_t m_elapsedNs = 0;
+  };
+}
@@ -0,0 +1,251 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "VideoFilters.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define VIDEO_FILTER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define VIDEO_FILTER_NEON
+#endif
+
+using namespace LIBRETRO;
+
+namespace
+{
+  //
+  // Operations on 4 pixels at a time, so each filter is written once for
+  // SSE2 and NEON
+  //
+
+#if defined(VIDEO_FILTER_SSE2)
+  #define VIDEO_FILTER_SIMD
+
+  using Pixels = __m128i;
+
+  inline Pixels Load(const uint32_t* source) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)); }
+  inline void Store(uint32_t* target, Pixels pixels) { _mm_storeu_si128(reinterpret_cast<__m128i*>(target), pixels); }
+  inline Pixels Equal(Pixels a, Pixels b) { return _mm_cmpeq_epi32(a, b); }
+  inline Pixels And(Pixels a, Pixels b) { return _mm_and_si128(a, b); }
+  inline Pixels AndNot(Pixels a, Pixels b) { return _mm_andnot_si128(b, a); } // a & ~b
+  inline Pixels Select(Pixels mask, Pixels a, Pixels b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+  inline Pixels Average(Pixels a, Pixels b) { return _mm_avg_epu8(a, b); }
+  inline Pixels InterleaveLow(Pixels a, Pixels b) { return _mm_unpacklo_epi32(a, b); }
+  inline Pixels InterleaveHigh(Pixels a, Pixels b) { return _mm_unpackhi_epi32(a, b); }
+#elif defined(VIDEO_FILTER_NEON)
+  #define VIDEO_FILTER_SIMD
+
+  using Pixels = uint32x4_t;
+
+  inline Pixels Load(const uint32_t* source) { return vld1q_u32(source); }
+  inline void Store(uint32_t* target, Pixels pixels) { vst1q_u32(target, pixels); }
+  inline Pixels Equal(Pixels a, Pixels b) { return vceqq_u32(a, b); }
+  inline Pixels And(Pixels a, Pixels b) { return vandq_u32(a, b); }
+  inline Pixels AndNot(Pixels a, Pixels b) { return vbicq_u32(a, b); } // a & ~b
+  inline Pixels Select(Pixels mask, Pixels a, Pixels b) { return vbslq_u32(mask, a, b); }
+  inline Pixels Average(Pixels a, Pixels b) { return vreinterpretq_u32_u8(vrhaddq_u8(vreinterpretq_u8_u32(a), vreinterpretq_u8_u32(b))); }
+  inline Pixels InterleaveLow(Pixels a, Pixels b) { return vzipq_u32(a, b).val[0]; }
+  inline Pixels InterleaveHigh(Pixels a, Pixels b) { return vzipq_u32(a, b).val[1]; }
+#endif
+
+  /*!
+   * \brief Per-channel average, rounding up like the SIMD instructions
+   */
+  inline uint32_t Average(uint32_t a, uint32_t b)
+  {
+    return (a | b) - (((a ^ b) >> 1) & 0x7f7f7f7f);
+  }
+
+  /*!
+   * \brief Per-channel interpolation, with weight in 1/256
+   */
+  inline uint32_t Interpolate(uint32_t a, uint32_t b, uint32_t weight)
+  {
+    // Red and blue, then green, each channel with 8 bits of headroom
+    const uint32_t rb = ((a & 0xff00ff) * (256 - weight) + (b & 0xff00ff) * weight + 0x800080) >> 8;
+    const uint32_t g = ((a & 0x00ff00) * (256 - weight) + (b & 0x00ff00) * weight + 0x008000) >> 8;
+
+    return (rb & 0xff00ff) | (g & 0x00ff00);
+  }
+
+  // Scale2x rules for the pixel P with neighbours A (above), B (right),
+  // C (left) and D (below). Each rule picks the colour of an edge that runs
+  // diagonally through the corner of P.
+  inline void Scale2xPixel(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t p, uint32_t* top, uint32_t* bottom)
+  {
+    top[0] = (c == a && c != d && a != b) ? a : p;
+    top[1] = (a == b && a != c && b != d) ? b : p;
+    bottom[0] = (d == c && d != b && c != a) ? c : p;
+    bottom[1] = (b == d && b != a && d != c) ? d : p;
+  }
+}
+
+void CNearestFilter::Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const
+{
+  const size_t targetRowSize = static_cast<size_t>(target.width) * 4;
+
+  for (unsigned int y = rowBegin; y < rowEnd; y++)
+  {
+    const uint32_t* row = source.Row(y);
+    uint32_t* targetRow = target.Row(y * m_scale);
+
+    unsigned int x = 0;
+
+#if defined(VIDEO_FILTER_SIMD)
+    if (m_scale == 2)
+    {
+      for (; x + 4 <= source.width; x += 4)
+      {
+        const Pixels pixels = Load(row + x);
+        Store(targetRow + 2 * x, InterleaveLow(pixels, pixels));
+        Store(targetRow + 2 * x + 4, InterleaveHigh(pixels, pixels));
+      }
+    }
+#endif
+
+    for (; x < source.width; x++)
+    {
+      for (unsigned int i = 0; i < m_scale; i++)
+        targetRow[x * m_scale + i] = row[x];
+    }
+
+    // The other rows are copies
+    for (unsigned int i = 1; i < m_scale; i++)
+      memcpy(target.Row(y * m_scale + i), targetRow, targetRowSize);
+  }
+}
+
+void CScale2xFilter::Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const
+{
+  const unsigned int width = source.width;
+
+  for (unsigned int y = rowBegin; y < rowEnd; y++)
+  {
+    const uint32_t* above = source.Row(y > 0 ? y - 1 : 0);
+    const uint32_t* row = source.Row(y);
+    const uint32_t* below = source.Row(std::min(y + 1, source.height - 1));
+
+    uint32_t* top = target.Row(2 * y);
+    uint32_t* bottom = target.Row(2 * y + 1);
+
+    // The first pixel has no left neighbour
+    Scale2xPixel(above[0], row[std::min(1u, width - 1)], row[0], below[0], row[0], top, bottom);
+
+    unsigned int x = 1;
+
+#if defined(VIDEO_FILTER_SIMD)
+    // Needs the right neighbour of the last pixel
+    for (; x + 5 <= width; x += 4)
+    {
+      const Pixels a = Load(above + x);
+      const Pixels b = Load(row + x + 1);
+      const Pixels c = Load(row + x - 1);
+      const Pixels d = Load(below + x);
+      const Pixels p = Load(row + x);
+
+      const Pixels cEqualsA = Equal(c, a);
+      const Pixels aEqualsB = Equal(a, b);
+      const Pixels cEqualsD = Equal(c, d);
+      const Pixels bEqualsD = Equal(b, d);
+
+      const Pixels topLeft = Select(AndNot(AndNot(cEqualsA, cEqualsD), aEqualsB), a, p);
+      const Pixels topRight = Select(AndNot(AndNot(aEqualsB, cEqualsA), bEqualsD), b, p);
+      const Pixels bottomLeft = Select(AndNot(AndNot(cEqualsD, bEqualsD), cEqualsA), c, p);
+      const Pixels bottomRight = Select(AndNot(AndNot(bEqualsD, aEqualsB), cEqualsD), d, p);
+
+      Store(top + 2 * x, InterleaveLow(topLeft, topRight));
+      Store(top + 2 * x + 4, InterleaveHigh(topLeft, topRight));
+      Store(bottom + 2 * x, InterleaveLow(bottomLeft, bottomRight));
+      Store(bottom + 2 * x + 4, InterleaveHigh(bottomLeft, bottomRight));
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+      const uint32_t right = row[std::min(x + 1, width - 1)];
+      Scale2xPixel(above[x], right, row[x - 1], below[x], row[x], top + 2 * x, bottom + 2 * x);
+    }
+  }
+}
+
+void CBilinearFilter::Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const
+{
+  const unsigned int width = source.width;
+
+  for (unsigned int y = rowBegin; y < rowEnd; y++)
+  {
+    // Pixels are interpolated towards the next row and column. The last
+    // row and column are interpolated with themselves.
+    const uint32_t* row = source.Row(y);
+    const uint32_t* nextRow = source.Row(std::min(y + 1, source.height - 1));
+
+    if (m_scale == 2)
+    {
+      uint32_t* top = target.Row(2 * y);
+      uint32_t* bottom = target.Row(2 * y + 1);
+
+      unsigned int x = 0;
+
+#if defined(VIDEO_FILTER_SIMD)
+      for (; x + 5 <= width; x += 4)
+      {
+        const Pixels p = Load(row + x);
+        const Pixels pRight = Average(p, Load(row + x + 1));
+        const Pixels q = Load(nextRow + x);
+        const Pixels qRight = Average(q, Load(nextRow + x + 1));
+
+        const Pixels top0 = InterleaveLow(p, pRight);
+        const Pixels top1 = InterleaveHigh(p, pRight);
+
+        Store(top + 2 * x, top0);
+        Store(top + 2 * x + 4, top1);
+        Store(bottom + 2 * x, Average(top0, InterleaveLow(q, qRight)));
+        Store(bottom + 2 * x + 4, Average(top1, InterleaveHigh(q, qRight)));
+      }
+#endif
+
+      for (; x < width; x++)
+      {
+        const unsigned int right = std::min(x + 1, width - 1);
+
+        const uint32_t p = row[x];
+        const uint32_t pRight = Average(p, row[right]);
+        const uint32_t q = nextRow[x];
+        const uint32_t qRight = Average(q, nextRow[right]);
+
+        top[2 * x] = p;
+        top[2 * x + 1] = pRight;
+        bottom[2 * x] = Average(p, q);
+        bottom[2 * x + 1] = Average(pRight, qRight);
+      }
+    }
+    else
+    {
+      for (unsigned int i = 0; i < m_scale; i++)
+      {
+        const uint32_t weightY = i * 256 / m_scale;
+        uint32_t* targetRow = target.Row(y * m_scale + i);
+
+        for (unsigned int x = 0; x < width; x++)
+        {
+          const unsigned int right = std::min(x + 1, width - 1);
+
+          const uint32_t left = Interpolate(row[x], nextRow[x], weightY);
+          const uint32_t rightPixel = Interpolate(row[right], nextRow[right], weightY);
+
+          for (unsigned int j = 0; j < m_scale; j++)
+            targetRow[x * m_scale + j] = Interpolate(left, rightPixel, j * 256 / m_scale);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "IVideoFilter.h"
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Integer nearest-neighbour scaling
+   */
+  class CNearestFilter : public IVideoFilter
+  {
+  public:
+    CNearestFilter(unsigned int scale) : m_scale(scale) { }
+
+    // Implementation of IVideoFilter
+    const char* Name() const override { return "nearest"; }
+    unsigned int Scale() const override { return m_scale; }
+    void Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const override;
+
+  private:
+    const unsigned int m_scale;
+  };
+
+  /*!
+   * \brief Scale2x (EPX), which doubles the size and smooths diagonal edges
+   *        without blurring
+   */
+  class CScale2xFilter : public IVideoFilter
+  {
+  public:
+    CScale2xFilter() = default;
+
+    // Implementation of IVideoFilter
+    const char* Name() const override { return "scale2x"; }
+    unsigned int Scale() const override { return 2; }
+    void Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const override;
+  };
+
+  /*!
+   * \brief Bilinear scaling by an integer factor
+   */
+  class CBilinearFilter : public IVideoFilter
+  {
+  public:
+    CBilinearFilter(unsigned int scale) : m_scale(scale) { }
+
+    // Implementation of IVideoFilter
+    const char* Name() const override { return "bilinear"; }
+    unsigned int Scale() const override { return m_scale; }
+    void Process(const VideoFrame& source, const VideoFrame& target, unsigned int rowBegin, unsigned int rowEnd) const override;
+
+  private:
+    const unsigned int m_scale;
+  };
+}
@@ -0,0 +1,353 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "VideoPostProcessor.h"
+#include "VideoFilters.h"
+#include "log/Log.h"
+#include "utils/FrameProfiler.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+#define MAX_SLICE_THREADS  4 // Including the worker
+#define MIN_SLICE_PIXELS   (256 * 1024) // Smaller frames aren't worth splitting
+
+void CVideoPostProcessor::FrameBuffer::Resize(unsigned int width, unsigned int height)
+{
+  frame.width = width;
+  frame.height = height;
+  frame.pitch = static_cast<size_t>(width) * 4;
+
+  // Only grows, so it stops allocating once the largest frame has been seen
+  if (storage.size() < frame.pitch * height)
+    storage.resize(frame.pitch * height);
+
+  frame.data = storage.data();
+}
+
+bool CVideoPostProcessor::Initialize(VIDEO_FILTER filter, unsigned int scale)
+{
+  Deinitialize();
+
+  scale = std::max(scale, 1u);
+
+  switch (filter)
+  {
+  case VIDEO_FILTER_NEAREST:
+    m_filters.emplace_back(new CNearestFilter(scale));
+    break;
+  case VIDEO_FILTER_SCALE2X:
+    for (unsigned int remaining = scale; remaining >= 2; remaining /= 2)
+      m_filters.emplace_back(new CScale2xFilter);
+    break;
+  case VIDEO_FILTER_BILINEAR:
+    m_filters.emplace_back(new CBilinearFilter(scale));
+    break;
+  default:
+    break;
+  }
+
+  if (m_filters.empty())
+    return false;
+
+  m_scale = 1;
+  for (const auto& videoFilter : m_filters)
+    m_scale *= videoFilter->Scale();
+
+  m_intermediate.resize(m_filters.size() - 1);
+
+  m_pendingInput = -1;
+  m_processingInput = -1;
+  m_bOutputReady = false;
+  m_bStop = false;
+  m_bStopHelpers = false;
+
+  const unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned int sliceThreads = std::min(cores, static_cast<unsigned int>(MAX_SLICE_THREADS));
+
+  for (unsigned int i = 1; i < sliceThreads; i++)
+    m_helpers.emplace_back(&CVideoPostProcessor::ProcessHelper, this);
+
+  m_worker = std::thread(&CVideoPostProcessor::Process, this);
+
+  isyslog("Video post-processing: %s x%u, %u thread(s)", m_filters.front()->Name(), m_scale,
+      static_cast<unsigned int>(m_helpers.size() + 1));
+
+  return true;
+}
+
+void CVideoPostProcessor::Deinitialize()
+{
+  if (m_worker.joinable())
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_bStop = true;
+    }
+    m_inputCondition.notify_all();
+    m_worker.join();
+  }
+
+  if (!m_helpers.empty())
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_sliceMutex);
+      m_bStopHelpers = true;
+    }
+    m_sliceCondition.notify_all();
+
+    for (std::thread& helper : m_helpers)
+      helper.join();
+    m_helpers.clear();
+  }
+
+  m_filters.clear();
+  m_intermediate.clear();
+  m_scale = 1;
+}
+
+void CVideoPostProcessor::Reset()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // A frame being filtered is finished, but not handed out
+  m_pendingInput = -1;
+  m_bOutputReady = false;
+  m_generation++;
+}
+
+void CVideoPostProcessor::Submit(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, int rotation)
+{
+  if (!IsEnabled())
+    return;
+
+  unsigned int slot;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // A frame still waiting is replaced by the newer one
+    if (m_pendingInput >= 0)
+    {
+      m_droppedFrames++;
+      m_pendingInput = -1;
+    }
+
+    slot = (m_processingInput == 0) ? 1 : 0;
+  }
+
+  // The worker only touches the other input while this one is copied
+  FrameBuffer& input = m_inputs[slot];
+  input.Resize(width, height);
+  input.rotation = rotation;
+  input.submitNs = CFrameProfiler::Now();
+
+  const size_t rowSize = static_cast<size_t>(width) * 4;
+  for (unsigned int y = 0; y < height; y++)
+    memcpy(input.frame.data + y * rowSize, data + y * pitch, rowSize);
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_pendingInput = static_cast<int>(slot);
+  }
+  m_inputCondition.notify_one();
+}
+
+bool CVideoPostProcessor::TakeFrame(VideoFrame& frame, int& rotation)
+{
+  if (!IsEnabled())
+    return false;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_bOutputReady)
+      return false;
+
+    std::swap(m_readyOutput, m_frontOutput);
+    m_bOutputReady = false;
+  }
+
+  const FrameBuffer& output = m_outputs[m_frontOutput];
+
+  m_latencyNs.Add(static_cast<uint64_t>(CFrameProfiler::Now() - output.submitNs));
+
+  frame = output.frame;
+  rotation = output.rotation;
+
+  return true;
+}
+
+void CVideoPostProcessor::LogStatistics() const
+{
+  const uint64_t frames = m_processNs.Count();
+  if (frames == 0)
+    return;
+
+  isyslog("Video post-processing: %llu frames filtered, %llu dropped because the worker fell behind",
+      static_cast<unsigned long long>(frames), static_cast<unsigned long long>(m_droppedFrames.load()));
+  isyslog("Video post-processing: filter time p50: %.2f ms  p99: %.2f ms  max: %.2f ms",
+      m_processNs.Percentile(0.5) / 1000000.0, m_processNs.Percentile(0.99) / 1000000.0,
+      m_processNs.Max() / 1000000.0);
+  isyslog("Video post-processing: stage latency p50: %.2f ms  p99: %.2f ms  max: %.2f ms",
+      m_latencyNs.Percentile(0.5) / 1000000.0, m_latencyNs.Percentile(0.99) / 1000000.0,
+      m_latencyNs.Max() / 1000000.0);
+}
+
+void CVideoPostProcessor::ResetStatistics()
+{
+  m_processNs.Reset();
+  m_latencyNs.Reset();
+  m_droppedFrames = 0;
+}
+
+void CVideoPostProcessor::Process()
+{
+  while (true)
+  {
+    unsigned int slot;
+    uint64_t generation;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_inputCondition.wait(lock, [this]() { return m_bStop || m_pendingInput >= 0; });
+
+      if (m_bStop)
+        break;
+
+      slot = static_cast<unsigned int>(m_pendingInput);
+      m_processingInput = m_pendingInput;
+      m_pendingInput = -1;
+      generation = m_generation;
+    }
+
+    const int64_t startNs = CFrameProfiler::Now();
+
+    const FrameBuffer& input = m_inputs[slot];
+    FrameBuffer& output = m_outputs[m_backOutput];
+
+    Filter(input, output);
+
+    output.rotation = input.rotation;
+    output.submitNs = input.submitNs;
+
+    m_processNs.Add(static_cast<uint64_t>(CFrameProfiler::Now() - startNs));
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_processingInput = -1;
+
+      // A frame reset while it was filtered isn't handed out
+      if (generation == m_generation)
+      {
+        std::swap(m_backOutput, m_readyOutput);
+        m_bOutputReady = true;
+      }
+    }
+  }
+}
+
+void CVideoPostProcessor::Filter(const FrameBuffer& input, FrameBuffer& output)
+{
+  VideoFrame source = input.frame;
+
+  for (size_t i = 0; i < m_filters.size(); i++)
+  {
+    const IVideoFilter& filter = *m_filters[i];
+
+    FrameBuffer& target = (i + 1 < m_filters.size()) ? m_intermediate[i] : output;
+    target.Resize(source.width * filter.Scale(), source.height * filter.Scale());
+
+    RunSlices(filter, source, target.frame);
+
+    source = target.frame;
+  }
+}
+
+void CVideoPostProcessor::RunSlices(const IVideoFilter& filter, const VideoFrame& source, const VideoFrame& target)
+{
+  const uint64_t targetPixels = static_cast<uint64_t>(target.width) * target.height;
+
+  if (m_helpers.empty() || targetPixels < MIN_SLICE_PIXELS || source.height < 2)
+  {
+    filter.Process(source, target, 0, source.height);
+    return;
+  }
+
+  SliceJob job;
+  job.filter = &filter;
+  job.source = source;
+  job.target = target;
+  job.sliceCount = std::min(static_cast<unsigned int>(m_helpers.size() + 1), source.height);
+
+  uint64_t jobId;
+  {
+    std::unique_lock<std::mutex> lock(m_sliceMutex);
+    m_sliceJob = job;
+    m_nextSlice = 0;
+    m_pendingSlices = job.sliceCount;
+    jobId = ++m_sliceJobId;
+  }
+  m_sliceCondition.notify_all();
+
+  // The worker takes slices too
+  ProcessSlices(job, jobId);
+
+  std::unique_lock<std::mutex> lock(m_sliceMutex);
+  m_sliceDoneCondition.wait(lock, [this]() { return m_pendingSlices == 0; });
+}
+
+void CVideoPostProcessor::ProcessSlices(const SliceJob& job, uint64_t jobId)
+{
+  while (true)
+  {
+    unsigned int slice;
+    {
+      std::unique_lock<std::mutex> lock(m_sliceMutex);
+
+      // A helper that woke up late must not take slices of the next job
+      if (m_sliceJobId != jobId || m_nextSlice >= job.sliceCount)
+        break;
+
+      slice = m_nextSlice++;
+    }
+
+    const unsigned int rowBegin = job.source.height * slice / job.sliceCount;
+    const unsigned int rowEnd = job.source.height * (slice + 1) / job.sliceCount;
+
+    job.filter->Process(job.source, job.target, rowBegin, rowEnd);
+
+    std::unique_lock<std::mutex> lock(m_sliceMutex);
+    if (--m_pendingSlices == 0)
+      m_sliceDoneCondition.notify_all();
+  }
+}
+
+void CVideoPostProcessor::ProcessHelper()
+{
+  uint64_t lastJobId = 0;
+
+  while (true)
+  {
+    SliceJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_sliceMutex);
+
+      m_sliceCondition.wait(lock, [this, lastJobId]() { return m_bStopHelpers || m_sliceJobId != lastJobId; });
+
+      if (m_bStopHelpers)
+        break;
+
+      job = m_sliceJob;
+      lastJobId = m_sliceJobId;
+    }
+
+    ProcessSlices(job, lastJobId);
+  }
+}
@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "IVideoFilter.h"
+#include "settings/Settings.h"
+#include "utils/Histogram.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Scales 0RGB8888 frames with CPU filters on a worker thread
+   *
+   * The emulation thread copies each frame into one of two input buffers and
+   * continues. The worker runs the frame through a chain of filters, and
+   * splits large frames into slices that are filtered in parallel by helper
+   * threads. Finished frames are picked up by the emulation thread on the
+   * next frame, so the stage adds one frame of latency.
+   *
+   * If the worker falls behind, the oldest waiting frame is dropped.
+   */
+  class CVideoPostProcessor
+  {
+  public:
+    CVideoPostProcessor() = default;
+    ~CVideoPostProcessor() { Deinitialize(); }
+
+    /*!
+     * \brief Build the filter chain and start the threads
+     *
+     * Scale2x only scales by powers of two, other scales are rounded down.
+     *
+     * \return False if the filter is VIDEO_FILTER_NONE or unknown
+     */
+    bool Initialize(VIDEO_FILTER filter, unsigned int scale);
+    void Deinitialize();
+
+    bool IsEnabled() const { return m_worker.joinable(); }
+
+    /*!
+     * \brief The output size, as a multiple of the input size
+     */
+    unsigned int Scale() const { return m_scale; }
+
+    /*!
+     * \brief Drop all frames in flight, e.g. when the stream is reopened
+     */
+    void Reset();
+
+    /*!
+     * \brief Copy a frame and queue it for filtering
+     */
+    void Submit(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, int rotation);
+
+    /*!
+     * \brief Get the most recently filtered frame, if there is a new one
+     *
+     * The frame stays valid until the next call.
+     *
+     * \param rotation Set to the rotation the frame was submitted with
+     *
+     * \return False if no frame has finished since the last call
+     */
+    bool TakeFrame(VideoFrame& frame, int& rotation);
+
+    void LogStatistics() const;
+    void ResetStatistics();
+
+  private:
+    struct FrameBuffer
+    {
+      std::vector<uint8_t> storage;
+      VideoFrame frame;
+      int rotation = 0;
+      int64_t submitNs = 0;
+
+      void Resize(unsigned int width, unsigned int height);
+    };
+
+    struct SliceJob
+    {
+      const IVideoFilter* filter = nullptr;
+      VideoFrame source;
+      VideoFrame target;
+      unsigned int sliceCount = 0;
+    };
+
+    // Worker thread functions
+    void Process();
+    void Filter(const FrameBuffer& input, FrameBuffer& output);
+    void RunSlices(const IVideoFilter& filter, const VideoFrame& source, const VideoFrame& target);
+    void ProcessSlices(const SliceJob& job, uint64_t jobId);
+
+    // Helper thread function
+    void ProcessHelper();
+
+    // Filter chain
+    std::vector<std::unique_ptr<IVideoFilter>> m_filters;
+    std::vector<FrameBuffer> m_intermediate; // Output of all but the last filter
+    unsigned int m_scale = 1;
+
+    // Pipeline
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_inputCondition;
+    std::array<FrameBuffer, 2> m_inputs;
+    std::array<FrameBuffer, 3> m_outputs;
+    int m_pendingInput = -1; // Input waiting for the worker, or -1
+    int m_processingInput = -1; // Input being filtered, or -1
+    unsigned int m_backOutput = 0; // Written by the worker
+    unsigned int m_readyOutput = 1; // Finished, waiting to be taken
+    unsigned int m_frontOutput = 2; // Taken by the emulation thread
+    bool m_bOutputReady = false;
+    bool m_bStop = false;
+    uint64_t m_generation = 0; // Incremented by Reset()
+
+    // Slice helpers
+    std::vector<std::thread> m_helpers;
+    std::mutex m_sliceMutex;
+    std::condition_variable m_sliceCondition;
+    std::condition_variable m_sliceDoneCondition;
+    SliceJob m_sliceJob;
+    uint64_t m_sliceJobId = 0;
+    unsigned int m_nextSlice = 0;
+    unsigned int m_pendingSlices = 0;
+    bool m_bStopHelpers = false;
+
+    // Statistics
+    CHistogram m_processNs; // Time spent filtering
+    CHistogram m_latencyNs; // Time from submitting to taking a frame
+    std::atomic<uint64_t> m_droppedFrames{0};
+  };
+}
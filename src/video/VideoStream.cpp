@@ -7,12 +7,32 @@
 
 #include "VideoStream.h"
 #include "VideoGeometry.h"
+#include "capture/InstantReplay.h"
+#include "capture/MediaCapture.h"
 #include "libretro/LibretroEnvironment.h"
+#include "log/Log.h"
+#include "settings/Settings.h"
+#include "utils/FrameProfiler.h"
+#include "utils/MemoryHash.h"
 
 #include "client.h"
 
+#include <algorithm>
+#include <string.h>
+
 using namespace LIBRETRO;
 
+#define OVERSCAN_CROP_DIVISOR  32 // Fraction cropped from each edge, 7 lines of a 240-line picture
+#define COMPACT_PITCH_RATIO  2 // Minimum pitch, in multiples of the row size, for rows to be compacted
+
+namespace
+{
+  size_t BytesPerPixel(GAME_PIXEL_FORMAT format)
+  {
+    return format == GAME_PIXEL_FORMAT_0RGB8888 ? 4 : 2;
+  }
+}
+
 CVideoStream::CVideoStream() :
   m_addon(nullptr),
   m_geometry(new CVideoGeometry)
@@ -22,6 +42,8 @@ CVideoStream::CVideoStream() :
 void CVideoStream::Initialize(CGameLibRetro* addon)
 {
   m_addon = addon;
+
+  m_converter.SelectKernel();
 }
 
 void CVideoStream::Deinitialize()
@@ -31,14 +53,27 @@ void CVideoStream::Deinitialize()
 
   CloseStream();
 
+  m_postProcessor.Deinitialize();
+  m_frameDiff.Deinitialize();
+
   m_addon = nullptr;
 }
 
 void CVideoStream::SetGeometry(const CVideoGeometry &geometry)
 {
-  // Close stream so it can be reopened with the updated geometry
-  if (m_addon != nullptr)
-    CloseStream();
+  if (m_addon != nullptr && m_stream.IsOpen())
+  {
+    if (NeedsReopen(geometry))
+    {
+      // Close stream so it can be reopened with the updated geometry
+      CloseStream();
+      m_geometryReopens++;
+    }
+    else
+    {
+      m_geometryChanges++;
+    }
+  }
 
   *m_geometry = geometry;
 }
@@ -59,6 +94,7 @@ bool CVideoStream::EnableHardwareRendering(const game_stream_hw_framebuffer_prop
     return false;
 
   m_streamType = GAME_STREAM_HW_FRAMEBUFFER;
+  OnStreamOpened();
 
   return true;
 }
@@ -71,15 +107,17 @@ uintptr_t CVideoStream::GetHwFramebuffer()
   if (!m_stream.IsOpen() || m_streamType != GAME_STREAM_HW_FRAMEBUFFER)
     return 0;
 
-  if (!m_framebuffer)
+  if (!m_bHwFramebufferAcquired)
   {
-    m_framebuffer.reset(new game_stream_buffer{});
+    m_hwFramebuffer = game_stream_buffer{};
 
-    if (!m_stream.GetBuffer(0, 0, *m_framebuffer))
+    if (!m_stream.GetBuffer(0, 0, m_hwFramebuffer))
       return 0;
+
+    m_bHwFramebufferAcquired = true;
   }
 
-  return m_framebuffer->hw_framebuffer.framebuffer;
+  return m_hwFramebuffer.hw_framebuffer.framebuffer;
 }
 
 bool CVideoStream::GetSwFramebuffer(unsigned int width, unsigned int height, GAME_PIXEL_FORMAT requestedFormat, game_stream_sw_framebuffer_buffer &framebuffer)
@@ -87,6 +125,30 @@ bool CVideoStream::GetSwFramebuffer(unsigned int width, unsigned int height, GAM
   if (m_addon == nullptr)
     return false;
 
+  // Let the core render into its own buffer if the frame won't be shown
+  if (!m_bEnabled)
+    return false;
+
+  // Let the core render into its own buffer if the frame will be converted
+  if (ShouldConvert(requestedFormat))
+    return false;
+
+  // Cropped frames start inside the buffer, which Kodi can't map back to
+  // its own framebuffer
+  if (CSettings::Get().CropOverscan())
+    return false;
+
+  // Filtered frames are written to the post-processor's buffers
+  if (CSettings::Get().PostProcessFilter() != VIDEO_FILTER_NONE)
+    return false;
+
+  // Buffers of the old format can't be handed out after a format change
+  if (m_stream.IsOpen() && m_streamType == GAME_STREAM_SW_FRAMEBUFFER && m_format != requestedFormat)
+  {
+    CloseStream();
+    m_formatReopens++;
+  }
+
   if (!m_stream.IsOpen())
   {
     game_stream_properties properties{};
@@ -101,67 +163,224 @@ bool CVideoStream::GetSwFramebuffer(unsigned int width, unsigned int height, GAM
 
     m_stream.Open(properties);
     m_streamType = GAME_STREAM_SW_FRAMEBUFFER;
+
+    // Save format to detect changes
+    m_format = requestedFormat;
+
+    OnStreamOpened();
   }
 
   if (!m_stream.IsOpen() || m_streamType != GAME_STREAM_SW_FRAMEBUFFER)
     return false;
 
-  if (!m_framebuffer)
+  // The core may ask more than once per frame
+  if (m_currentSlot >= 0)
+  {
+    const FramebufferSlot& slot = m_swFramebuffers[m_currentSlot];
+    if (slot.width == width && slot.height == height)
+    {
+      framebuffer = slot.buffer.sw_framebuffer;
+      return true;
+    }
+  }
+
+  FramebufferSlot& slot = m_swFramebuffers[m_nextSlot];
+
+  // Reusing the oldest slot returns its buffer to Kodi. The buffers of the
+  // newer slots may still be in use for frames that were just submitted.
+  if (slot.bAcquired)
+  {
+    m_stream.ReleaseBuffer(slot.buffer);
+    slot.bAcquired = false;
+  }
+
+  slot.buffer = game_stream_buffer{};
+  if (!m_stream.GetBuffer(width, height, slot.buffer))
   {
-    m_framebuffer.reset(new game_stream_buffer{});
+    // The core falls back to its own buffer
+    m_framebufferFailures++;
+    return false;
+  }
 
-    if (!m_stream.GetBuffer(width, height, *m_framebuffer))
-      return false;
+  // Kodi may not be able to provide the requested format
+  if (slot.buffer.sw_framebuffer.format != requestedFormat || slot.buffer.sw_framebuffer.data == nullptr ||
+      slot.buffer.sw_framebuffer.size < static_cast<size_t>(width) * height * BytesPerPixel(requestedFormat))
+  {
+    m_stream.ReleaseBuffer(slot.buffer);
+    m_framebufferFailures++;
+    return false;
   }
 
-  framebuffer = m_framebuffer->sw_framebuffer;
+  slot.width = width;
+  slot.height = height;
+  slot.bAcquired = true;
+
+  m_currentSlot = static_cast<int>(m_nextSlot);
+  m_nextSlot = (m_nextSlot + 1) % SW_FRAMEBUFFER_SLOTS;
+
+  framebuffer = slot.buffer.sw_framebuffer;
 
   return true;
 }
 
-void CVideoStream::AddFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation)
+void CVideoStream::AddFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation)
 {
-  if (m_addon == nullptr)
+  if (m_addon == nullptr || !m_bEnabled)
     return;
 
-  // Only care if format changes for video stream
-  if (m_streamType == GAME_STREAM_VIDEO)
+  CFrameTimer videoTimer(FRAME_PHASE_VIDEO);
+
+  // Captured before cropping, as the core rendered it
+  CMediaCapture::Get().AddVideoFrame(data, width, height, pitch, format);
+  CInstantReplay::Get().AddVideoFrame(data, width, height, pitch, format);
+
+  // Only care if format changes for software streams
+  if (m_stream.IsOpen() && (m_streamType == GAME_STREAM_VIDEO || m_streamType == GAME_STREAM_SW_FRAMEBUFFER))
   {
     if (m_format != format)
     {
       // Close stream so it can be reopened with the updated format
       CloseStream();
+      m_formatReopens++;
     }
   }
 
   if (!m_stream.IsOpen())
   {
+    const bool bCropOverscan = CSettings::Get().CropOverscan();
+    const bool bPostProcess = m_postProcessor.Initialize(CSettings::Get().PostProcessFilter(), CSettings::Get().PostProcessScale());
+
+    unsigned int nominalWidth = m_geometry->NominalWidth();
+    unsigned int nominalHeight = m_geometry->NominalHeight();
+    float aspectRatio = m_geometry->AspectRatio();
+
+    // Report the cropped size, so that cropped frames don't look like a
+    // geometry change
+    if (bCropOverscan && nominalWidth > 0 && nominalHeight > 0)
+    {
+      const uint8_t* nominalData = nullptr;
+      unsigned int croppedWidth = nominalWidth;
+      unsigned int croppedHeight = nominalHeight;
+      CropOverscan(nominalData, croppedWidth, croppedHeight, 0, format);
+
+      // Cropping keeps the shape of the pixels, not the picture
+      if (aspectRatio > 0.0f)
+        aspectRatio *= (static_cast<float>(croppedWidth) / nominalWidth) / (static_cast<float>(croppedHeight) / nominalHeight);
+
+      nominalWidth = croppedWidth;
+      nominalHeight = croppedHeight;
+    }
+
+    unsigned int maxWidth = m_geometry->MaxWidth();
+    unsigned int maxHeight = m_geometry->MaxHeight();
+
+    if (bPostProcess)
+    {
+      nominalWidth *= m_postProcessor.Scale();
+      nominalHeight *= m_postProcessor.Scale();
+      maxWidth *= m_postProcessor.Scale();
+      maxHeight *= m_postProcessor.Scale();
+    }
+
     game_stream_properties properties{};
 
     properties.type = GAME_STREAM_VIDEO;
-    properties.video.format = format;
-    properties.video.nominal_width = m_geometry->NominalWidth();
-    properties.video.nominal_height = m_geometry->NominalHeight();
-    properties.video.max_width = m_geometry->MaxWidth();
-    properties.video.max_height = m_geometry->MaxHeight();
-    properties.video.aspect_ratio = m_geometry->AspectRatio();
+    properties.video.format = ShouldConvert(format) ? GAME_PIXEL_FORMAT_0RGB8888 : format;
+    properties.video.nominal_width = nominalWidth;
+    properties.video.nominal_height = nominalHeight;
+    properties.video.max_width = maxWidth;
+    properties.video.max_height = maxHeight;
+    properties.video.aspect_ratio = aspectRatio;
 
     m_stream.Open(properties);
     m_streamType = GAME_STREAM_VIDEO;
 
     // Save format to detect unwanted changes
     m_format = format;
+
+    OnStreamOpened();
   }
 
   if (!m_stream.IsOpen())
     return;
 
+  m_receivedBytes += pitch * height;
+
+  if (m_bCropOverscan)
+    CropOverscan(data, width, height, pitch, format);
+
+  if (m_bTrackChanges)
+    m_frameDiff.Compare(data, width, height, pitch, static_cast<unsigned int>(BytesPerPixel(format)));
+
+  if (m_bSkipIdenticalFrames)
+  {
+    bool bIdentical;
+
+    if (m_bTrackChanges)
+    {
+      // The frame was just compared with the previous one, so it doesn't
+      // need to be hashed
+      bIdentical = m_frameDiff.DirtyTileCount() == 0 && rotation == m_frameRotation;
+      m_frameRotation = rotation;
+    }
+    else
+    {
+      const int64_t startNs = CFrameProfiler::Now();
+      const uint64_t frameHash = HashFrame(data, width, height, pitch, format, rotation);
+      m_hashNs += static_cast<uint64_t>(CFrameProfiler::Now() - startNs);
+
+      bIdentical = frameHash == m_frameHash;
+      m_frameHash = frameHash;
+    }
+
+    // Kodi is still presenting the same image
+    if (m_bHasFrame && bIdentical)
+    {
+      m_identicalFrames++;
+
+      // The previous frame may still be coming out of the post-processor
+      if (m_bPostProcess)
+        AddPostProcessedFrame();
+
+      return;
+    }
+  }
+
+  // Kodi derives the pitch from the size of the frame
+  size_t size = pitch * height;
+
   game_stream_packet packet{};
 
   switch (m_streamType)
   {
   case GAME_STREAM_VIDEO:
   {
+    if (m_bConvertPixels)
+    {
+      if (format == GAME_PIXEL_FORMAT_RGB565)
+        m_converter.ConvertRGB565(data, width, height, pitch);
+      else
+        m_converter.Convert0RGB1555(data, width, height, pitch);
+
+      data = m_converter.Data();
+      size = m_converter.Size();
+      pitch = m_converter.Pitch();
+    }
+    else if (!m_bPostProcess && ShouldCompact(width, pitch, format))
+    {
+      data = CompactFrame(data, width, height, pitch, format);
+      size = m_compactFrame.size();
+    }
+
+    if (m_bPostProcess)
+    {
+      // Submit the previous frame before queuing this one, which is filtered
+      // while the core emulates the next frame
+      AddPostProcessedFrame();
+      m_postProcessor.Submit(data, width, height, pitch, rotation);
+      return;
+    }
+
     packet.type = GAME_STREAM_VIDEO;
     packet.video.width = width;
     packet.video.height = height;
@@ -172,6 +391,17 @@ void CVideoStream::AddFrame(const uint8_t* data, unsigned int size, unsigned int
   }
   case GAME_STREAM_SW_FRAMEBUFFER:
   {
+    // The core rendered straight into Kodi's buffer
+    if (m_currentSlot >= 0 && data == m_swFramebuffers[m_currentSlot].buffer.sw_framebuffer.data)
+    {
+      m_zeroCopyFrames++;
+    }
+    else if (ShouldCompact(width, pitch, format))
+    {
+      data = CompactFrame(data, width, height, pitch, format);
+      size = m_compactFrame.size();
+    }
+
     packet.type = GAME_STREAM_SW_FRAMEBUFFER;
     packet.sw_framebuffer.width = width;
     packet.sw_framebuffer.height = height;
@@ -185,23 +415,44 @@ void CVideoStream::AddFrame(const uint8_t* data, unsigned int size, unsigned int
   }
 
   m_stream.AddData(packet);
+
+  m_bHasFrame = true;
+  m_submittedFrames++;
+  m_submittedBytes += size;
+}
+
+void CVideoStream::DupeFrame()
+{
+  if (m_addon == nullptr || !m_bEnabled)
+    return;
+
+  CMediaCapture::Get().DupeVideoFrame();
+  CInstantReplay::Get().DupeVideoFrame();
+
+  if (m_bHasFrame)
+    m_dupeFrames++;
+
+  if (m_bPostProcess && m_stream.IsOpen())
+    AddPostProcessedFrame();
 }
 
 void CVideoStream::RenderHwFrame()
 {
-  if (m_addon == nullptr)
+  if (m_addon == nullptr || !m_bEnabled)
     return;
 
+  CFrameTimer videoTimer(FRAME_PHASE_VIDEO);
+
   if (!m_stream.IsOpen() || m_streamType != GAME_STREAM_HW_FRAMEBUFFER)
     return;
 
-  if (!m_framebuffer)
+  if (!m_bHwFramebufferAcquired)
     return;
 
   game_stream_packet packet{};
 
   packet.type = GAME_STREAM_HW_FRAMEBUFFER;
-  packet.hw_framebuffer.framebuffer = m_framebuffer->hw_framebuffer.framebuffer;
+  packet.hw_framebuffer.framebuffer = m_hwFramebuffer.hw_framebuffer.framebuffer;
 
   m_stream.AddData(packet);
 }
@@ -214,18 +465,235 @@ void CVideoStream::OnFrameEnd()
   if (!m_stream.IsOpen())
     return;
 
-  if (!m_framebuffer)
+  // Software framebuffers stay acquired until their slot is reused
+  m_currentSlot = -1;
+
+  if (m_bHwFramebufferAcquired)
+  {
+    m_stream.ReleaseBuffer(m_hwFramebuffer);
+    m_bHwFramebufferAcquired = false;
+  }
+}
+
+void CVideoStream::LogStatistics() const
+{
+  m_converter.LogStatistics();
+  m_postProcessor.LogStatistics();
+  m_frameDiff.LogStatistics();
+
+  if (m_streamOpens > 0)
+  {
+    isyslog("Video: stream opened %llu times, reopened %llu times for geometry and %llu times for format, "
+        "%llu geometry changes without reopening",
+        static_cast<unsigned long long>(m_streamOpens), static_cast<unsigned long long>(m_geometryReopens),
+        static_cast<unsigned long long>(m_formatReopens), static_cast<unsigned long long>(m_geometryChanges));
+  }
+
+  if (m_submittedFrames == 0)
     return;
 
-  m_stream.ReleaseBuffer(*m_framebuffer);
-  m_framebuffer.reset();
+  isyslog("Video: %llu frames submitted, %llu dupes from the core, %llu identical frames skipped",
+      static_cast<unsigned long long>(m_submittedFrames), static_cast<unsigned long long>(m_dupeFrames),
+      static_cast<unsigned long long>(m_identicalFrames));
+
+  isyslog("Video: avg %.1f KB per frame from the core, %.1f KB per frame submitted, %llu frames compacted",
+      m_receivedBytes / 1024.0 / (m_submittedFrames + m_identicalFrames), m_submittedBytes / 1024.0 / m_submittedFrames,
+      static_cast<unsigned long long>(m_compactedFrames));
+
+  if (m_streamType == GAME_STREAM_SW_FRAMEBUFFER || m_zeroCopyFrames > 0 || m_framebufferFailures > 0)
+  {
+    isyslog("Video: %llu frames rendered into Kodi's framebuffers, %llu framebuffer requests fell back to the core's buffer",
+        static_cast<unsigned long long>(m_zeroCopyFrames), static_cast<unsigned long long>(m_framebufferFailures));
+  }
+
+  if (m_hashNs > 0)
+  {
+    isyslog("Video: frame hashing avg %.1f us",
+        m_hashNs / 1000.0 / (m_submittedFrames + m_identicalFrames));
+  }
+}
+
+void CVideoStream::ResetStatistics()
+{
+  m_converter.ResetStatistics();
+  m_postProcessor.ResetStatistics();
+  m_frameDiff.ResetStatistics();
+
+  m_streamOpens = 0;
+  m_geometryReopens = 0;
+  m_formatReopens = 0;
+  m_geometryChanges = 0;
+  m_submittedFrames = 0;
+  m_zeroCopyFrames = 0;
+  m_compactedFrames = 0;
+  m_receivedBytes = 0;
+  m_submittedBytes = 0;
+  m_framebufferFailures = 0;
+  m_dupeFrames = 0;
+  m_identicalFrames = 0;
+  m_hashNs = 0;
+}
+
+void CVideoStream::ReleaseFramebuffers()
+{
+  for (FramebufferSlot& slot : m_swFramebuffers)
+  {
+    if (slot.bAcquired)
+    {
+      m_stream.ReleaseBuffer(slot.buffer);
+      slot.bAcquired = false;
+    }
+  }
+
+  m_currentSlot = -1;
+  m_nextSlot = 0;
+
+  if (m_bHwFramebufferAcquired)
+  {
+    m_stream.ReleaseBuffer(m_hwFramebuffer);
+    m_bHwFramebufferAcquired = false;
+  }
 }
 
 void CVideoStream::CloseStream()
 {
   if (m_stream.IsOpen())
   {
+    ReleaseFramebuffers();
     m_stream.Close();
     m_format = GAME_PIXEL_FORMAT_UNKNOWN;
+    m_bHasFrame = false;
+    m_frameDiff.Reset();
+    m_postProcessor.Reset();
   }
 }
+
+void CVideoStream::OnStreamOpened()
+{
+  if (!m_stream.IsOpen())
+    return;
+
+  m_streamMaxWidth = m_geometry->MaxWidth();
+  m_streamMaxHeight = m_geometry->MaxHeight();
+  m_streamAspectRatio = m_geometry->AspectRatio();
+
+  m_bTrackChanges = CSettings::Get().TrackVideoChanges();
+  m_bSkipIdenticalFrames = CSettings::Get().SkipIdenticalFrames();
+
+  // Frames are only converted, cropped and filtered on their way into a
+  // video stream. Framebuffers are shown as the core rendered them.
+  const bool bVideo = (m_streamType == GAME_STREAM_VIDEO);
+
+  m_bConvertPixels = bVideo && ShouldConvert(m_format);
+  m_bCropOverscan = bVideo && CSettings::Get().CropOverscan();
+
+  if (!bVideo)
+    m_postProcessor.Deinitialize();
+  m_bPostProcess = m_postProcessor.IsEnabled();
+
+  m_streamOpens++;
+}
+
+bool CVideoStream::NeedsReopen(const CVideoGeometry &geometry) const
+{
+  // Hardware framebuffers don't depend on the geometry
+  if (m_streamType == GAME_STREAM_HW_FRAMEBUFFER)
+    return false;
+
+  // Frames up to the maximum size fit in the stream's buffers
+  if (geometry.MaxWidth() > m_streamMaxWidth || geometry.MaxHeight() > m_streamMaxHeight)
+    return true;
+
+  // The aspect ratio can only be given when opening the stream
+  return geometry.AspectRatio() != m_streamAspectRatio;
+}
+
+void CVideoStream::CropOverscan(const uint8_t*& data, unsigned int& width, unsigned int& height, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  const unsigned int cropY = height / OVERSCAN_CROP_DIVISOR;
+  const unsigned int cropX = width / OVERSCAN_CROP_DIVISOR;
+
+  // Kodi reads pitch * height bytes from the start of the cropped frame, so
+  // the rows cropped from the bottom must cover the offset into the row
+  if (cropY == 0)
+    return;
+
+  if (data != nullptr)
+    data += cropY * pitch + cropX * BytesPerPixel(format);
+
+  width -= 2 * cropX;
+  height -= 2 * cropY;
+}
+
+bool CVideoStream::ShouldCompact(unsigned int width, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  // Compacting costs a copy of the visible pixels, so it only pays off if
+  // at least as much padding is saved from the copy Kodi makes
+  return pitch >= width * BytesPerPixel(format) * COMPACT_PITCH_RATIO;
+}
+
+const uint8_t* CVideoStream::CompactFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format)
+{
+  const size_t rowSize = width * BytesPerPixel(format);
+
+  // Only grows, so it stops allocating once the largest frame has been seen
+  m_compactFrame.resize(rowSize * height);
+
+  for (unsigned int y = 0; y < height; y++)
+    memcpy(m_compactFrame.data() + y * rowSize, data + y * pitch, rowSize);
+
+  m_compactedFrames++;
+
+  return m_compactFrame.data();
+}
+
+void CVideoStream::AddPostProcessedFrame()
+{
+  VideoFrame frame;
+  int rotation;
+  if (!m_postProcessor.TakeFrame(frame, rotation))
+    return;
+
+  const size_t size = frame.pitch * frame.height;
+
+  game_stream_packet packet{};
+
+  packet.type = GAME_STREAM_VIDEO;
+  packet.video.width = frame.width;
+  packet.video.height = frame.height;
+  packet.video.rotation = static_cast<GAME_VIDEO_ROTATION>(rotation);
+  packet.video.data = frame.data;
+  packet.video.size = size;
+
+  m_stream.AddData(packet);
+
+  m_bHasFrame = true;
+  m_submittedFrames++;
+  m_submittedBytes += size;
+}
+
+bool CVideoStream::ShouldConvert(GAME_PIXEL_FORMAT format)
+{
+  // Filters only work on 0RGB8888
+  if (CSettings::Get().PostProcessFilter() != VIDEO_FILTER_NONE)
+    return format == GAME_PIXEL_FORMAT_RGB565 || format == GAME_PIXEL_FORMAT_0RGB1555;
+
+  if (!CSettings::Get().ConvertPixelFormat())
+    return false;
+
+  return format == GAME_PIXEL_FORMAT_RGB565 || format == GAME_PIXEL_FORMAT_0RGB1555;
+}
+
+uint64_t CVideoStream::HashFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation)
+{
+  // A change in dimensions or rotation is a change even if the bytes match
+  uint64_t hash = (static_cast<uint64_t>(width) << 32) ^ (static_cast<uint64_t>(height) << 8) ^ rotation;
+
+  // Row padding is left out, cores don't necessarily clear it
+  const size_t rowSize = std::min(pitch, width * BytesPerPixel(format));
+
+  for (unsigned int y = 0; y < height; y++)
+    hash = CMemoryHash::Compute(data + y * pitch, rowSize, hash);
+
+  return hash;
+}
@@ -7,10 +7,16 @@
 
 #pragma once
 
+#include "FrameDiff.h"
+#include "PixelConverter.h"
+#include "VideoPostProcessor.h"
+
 #include <kodi/addon-instance/Game.h>
 
+#include <array>
 #include <memory>
 #include <stdint.h>
+#include <vector>
 
 class CGameLibRetro;
 
@@ -26,22 +32,120 @@ namespace LIBRETRO
     void Initialize(CGameLibRetro* addon);
     void Deinitialize();
 
+    /*!
+     * \brief Update the geometry of the core's video
+     *
+     * The stream is only reopened if frames of the new geometry don't fit.
+     */
     void SetGeometry(const CVideoGeometry &geometry);
+    const CVideoGeometry& Geometry() const { return *m_geometry; }
+
+    /*!
+     * \brief Enable or disable video output
+     *
+     * While disabled, frames from the core are discarded without being
+     * processed. This is used for frames that are emulated but not shown.
+     */
+    void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+    bool IsEnabled() const { return m_bEnabled; }
 
     bool EnableHardwareRendering(const game_stream_hw_framebuffer_properties &properties);
 
     uintptr_t GetHwFramebuffer();
     bool GetSwFramebuffer(unsigned int width, unsigned int height, GAME_PIXEL_FORMAT requestedFormat, game_stream_sw_framebuffer_buffer &framebuffer);
 
-    void AddFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation);
-    void DupeFrame() { } // Not supported
+    /*!
+     * \brief Add a software frame to the stream
+     *
+     * \param data The frame
+     * \param width The width in pixels
+     * \param height The height in pixels
+     * \param pitch The distance between rows, in bytes
+     * \param format The pixel format
+     * \param rotation The rotation
+     */
+    void AddFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation);
+
+    /*!
+     * \brief Handle a frame that the core reports as unchanged
+     *
+     * Kodi keeps presenting the last frame it received, so nothing needs to
+     * be resubmitted.
+     */
+    void DupeFrame();
+
     void RenderHwFrame();
 
     void OnFrameEnd();
 
+    void LogStatistics() const;
+    void ResetStatistics();
+
   private:
     void CloseStream();
 
+    /*!
+     * \brief Return all acquired framebuffers to Kodi
+     */
+    void ReleaseFramebuffers();
+
+    /*!
+     * \brief Record the properties of a newly opened stream
+     *
+     * Called by every path that opens a stream, so the frame processing
+     * always matches the type of the open stream and the current settings.
+     */
+    void OnStreamOpened();
+
+    /*!
+     * \brief True if the open stream can't show frames of the given geometry
+     *
+     * The stream is opened at the maximum size, so the resolution can change
+     * within it without reopening.
+     */
+    bool NeedsReopen(const CVideoGeometry &geometry) const;
+
+    /*!
+     * \brief True if frames of the given format are converted before being
+     *        added to the stream
+     */
+    static bool ShouldConvert(GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief Hash the visible pixels of a frame, excluding row padding
+     */
+    static uint64_t HashFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format, GAME_VIDEO_ROTATION rotation);
+
+    /*!
+     * \brief Crop the edges that a TV would hide from a frame
+     *
+     * No pixels are copied. The data pointer is moved to the first visible
+     * pixel, and the frame keeps its pitch.
+     */
+    static void CropOverscan(const uint8_t*& data, unsigned int& width, unsigned int& height, size_t pitch, GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief True if a frame has so much row padding that it should be
+     *        submitted without it
+     *
+     * The Game API has no pitch, Kodi derives it from the frame size and
+     * copies the padding along with the pixels.
+     */
+    static bool ShouldCompact(unsigned int width, size_t pitch, GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief Copy the visible pixels of a frame into a tightly packed buffer
+     *
+     * \return The compacted frame
+     */
+    const uint8_t* CompactFrame(const uint8_t* data, unsigned int width, unsigned int height, size_t pitch, GAME_PIXEL_FORMAT format);
+
+    /*!
+     * \brief Add the last frame finished by the post-processor to the
+     *        stream, if there is one
+     */
+    void AddPostProcessedFrame();
+
     // Initialization parameters
     CGameLibRetro* m_addon;
 
@@ -50,6 +154,72 @@ namespace LIBRETRO
     std::unique_ptr<CVideoGeometry> m_geometry;
     GAME_STREAM_TYPE m_streamType = GAME_STREAM_UNKNOWN;
     GAME_PIXEL_FORMAT m_format = GAME_PIXEL_FORMAT_UNKNOWN; // Guard against libretro changing formats
-    std::unique_ptr<game_stream_buffer> m_framebuffer;
+
+    // Software framebuffers the core renders into, used round-robin. A
+    // buffer is only released when its slot is reused, so the buffers of
+    // the most recent frames are never handed out again while Kodi may
+    // still read them.
+    static constexpr unsigned int SW_FRAMEBUFFER_SLOTS = 3;
+    struct FramebufferSlot
+    {
+      game_stream_buffer buffer{};
+      unsigned int width = 0;
+      unsigned int height = 0;
+      bool bAcquired = false;
+    };
+    std::array<FramebufferSlot, SW_FRAMEBUFFER_SLOTS> m_swFramebuffers;
+    int m_currentSlot = -1; // Slot handed to the core this frame, or -1
+    unsigned int m_nextSlot = 0;
+
+    // Hardware framebuffer, released at the end of every frame
+    game_stream_buffer m_hwFramebuffer{};
+    bool m_bHwFramebufferAcquired = false;
+    bool m_bEnabled = true;
+
+    // Geometry the stream was opened with
+    unsigned int m_streamMaxWidth = 0;
+    unsigned int m_streamMaxHeight = 0;
+    float m_streamAspectRatio = 0.0f;
+
+    // Pixel format conversion
+    CPixelConverter m_converter;
+    bool m_bConvertPixels = false;
+
+    // Overscan cropping
+    bool m_bCropOverscan = false;
+
+    // Post-processing
+    CVideoPostProcessor m_postProcessor;
+    bool m_bPostProcess = false;
+
+    // Frame without row padding
+    std::vector<uint8_t> m_compactFrame;
+
+    // Changed region tracking. The Game API can't send the changed regions
+    // along with a frame yet, so they are used to detect identical frames
+    // and for statistics.
+    CFrameDiff m_frameDiff;
+    bool m_bTrackChanges = false;
+
+    // Duplicate frame detection
+    bool m_bSkipIdenticalFrames = false;
+    bool m_bHasFrame = false; // True once a frame has been added to the stream
+    uint64_t m_frameHash = 0; // Hash of the last frame, if changes aren't tracked
+    GAME_VIDEO_ROTATION m_frameRotation = GAME_VIDEO_ROTATION_0; // Of the last frame, if changes are tracked
+
+    // Statistics
+    uint64_t m_streamOpens = 0;
+    uint64_t m_geometryReopens = 0;
+    uint64_t m_formatReopens = 0;
+    uint64_t m_geometryChanges = 0;
+    uint64_t m_submittedFrames = 0;
+    uint64_t m_zeroCopyFrames = 0;
+    uint64_t m_compactedFrames = 0;
+    uint64_t m_receivedBytes = 0;
+    uint64_t m_submittedBytes = 0;
+    uint64_t m_framebufferFailures = 0;
+    uint64_t m_dupeFrames = 0;
+    uint64_t m_identicalFrames = 0;
+    uint64_t m_hashNs = 0;
   };
 }
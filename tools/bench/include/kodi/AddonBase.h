@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Stand-in for the parts of Kodi's add-on dev-kit used by the add-on
+ * sources that the benchmark links. Logging goes to stderr, and settings
+ * are answered by the bench frontend.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define ATTR_DLL_LOCAL
+
+typedef enum ADDON_STATUS
+{
+  ADDON_STATUS_OK,
+  ADDON_STATUS_LOST_CONNECTION,
+  ADDON_STATUS_NEED_RESTART,
+  ADDON_STATUS_NEED_SETTINGS,
+  ADDON_STATUS_UNKNOWN,
+  ADDON_STATUS_PERMANENT_FAILURE,
+  ADDON_STATUS_NOT_IMPLEMENTED
+} ADDON_STATUS;
+
+typedef enum ADDON_LOG
+{
+  ADDON_LOG_DEBUG = 0,
+  ADDON_LOG_INFO = 1,
+  ADDON_LOG_WARNING = 2,
+  ADDON_LOG_ERROR = 3,
+  ADDON_LOG_FATAL = 4
+} ADDON_LOG;
+
+typedef enum OpenFileFlags
+{
+  ADDON_READ_TRUNCATED = 0x01,
+  ADDON_READ_CHUNKED = 0x02,
+  ADDON_READ_CACHED = 0x04,
+  ADDON_READ_NO_CACHE = 0x08,
+  ADDON_READ_BITRATE = 0x10,
+  ADDON_READ_MULTI_STREAM = 0x20,
+  ADDON_READ_AUDIO_VIDEO = 0x40,
+  ADDON_READ_AFTER_WRITE = 0x80,
+  ADDON_READ_REOPEN = 0x100
+} OpenFileFlags;
+
+namespace kodi
+{
+  inline void Log(const ADDON_LOG loglevel, const char* format, ...)
+  {
+    // The add-on's own logging goes through CLog, which has a level set
+    // with -v. This only receives the few direct calls.
+    if (loglevel < ADDON_LOG_WARNING)
+      return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+  }
+
+namespace addon
+{
+  /*!
+   * \brief Value of an add-on setting, given as a string on the command line
+   */
+  class CSettingValue
+  {
+  public:
+    CSettingValue() = default;
+    explicit CSettingValue(const std::string& settingValue) : m_str(settingValue) { }
+
+    bool empty() const { return m_str.empty(); }
+    std::string GetString() const { return m_str; }
+    int GetInt() const { return atoi(m_str.c_str()); }
+    unsigned int GetUInt() const { return static_cast<unsigned int>(strtoul(m_str.c_str(), nullptr, 10)); }
+    bool GetBoolean() const { return m_str == "true" || m_str == "1"; }
+    float GetFloat() const { return static_cast<float>(atof(m_str.c_str())); }
+
+  private:
+    std::string m_str;
+  };
+
+  /*!
+   * \brief Get the value of a core option set with -o
+   *
+   * Implemented by the bench frontend.
+   */
+  bool CheckSettingString(const std::string& settingName, std::string& settingValue);
+}
+}
@@ -0,0 +1,241 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Stand-in for Kodi's VFS, implemented with stdio and POSIX calls. Only
+ * local paths are supported.
+ */
+
+#include "AddonBase.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+namespace kodi
+{
+namespace vfs
+{
+  class FileStatus
+  {
+  public:
+    bool GetIsDirectory() const { return S_ISDIR(m_mode); }
+    bool GetIsCharacter() const { return S_ISCHR(m_mode); }
+    bool GetIsSymLink() const { return S_ISLNK(m_mode); }
+    uint64_t GetSize() const { return m_size; }
+
+  private:
+    friend bool StatFile(const std::string& filename, FileStatus& buffer);
+
+    mode_t m_mode = 0;
+    uint64_t m_size = 0;
+  };
+
+  class CDirEntry
+  {
+  public:
+    CDirEntry(const std::string& label, const std::string& path, bool bFolder, int64_t size) :
+      m_label(label),
+      m_path(path),
+      m_bFolder(bFolder),
+      m_size(size)
+    {
+    }
+
+    const std::string& Label() const { return m_label; }
+    const std::string& Path() const { return m_path; }
+    bool IsFolder() const { return m_bFolder; }
+    int64_t Size() const { return m_size; }
+
+  private:
+    std::string m_label;
+    std::string m_path;
+    bool m_bFolder;
+    int64_t m_size;
+  };
+
+  inline bool StatFile(const std::string& filename, FileStatus& buffer)
+  {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+      return false;
+
+    buffer.m_mode = st.st_mode;
+    buffer.m_size = static_cast<uint64_t>(st.st_size);
+    return true;
+  }
+
+  inline bool FileExists(const std::string& filename, bool usecache = false)
+  {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 && !S_ISDIR(st.st_mode);
+  }
+
+  inline bool DirectoryExists(const std::string& path)
+  {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  }
+
+  inline bool CreateDirectory(const std::string& path)
+  {
+    // Create missing parents, like Kodi does
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1))
+      mkdir(path.substr(0, pos).c_str(), 0755);
+
+    return mkdir(path.c_str(), 0755) == 0 || DirectoryExists(path);
+  }
+
+  inline bool DeleteFile(const std::string& filename)
+  {
+    return unlink(filename.c_str()) == 0;
+  }
+
+  inline bool RenameFile(const std::string& filename, const std::string& newFileName)
+  {
+    return rename(filename.c_str(), newFileName.c_str()) == 0;
+  }
+
+  inline std::string GetFileName(const std::string& path)
+  {
+    const size_t pos = path.find_last_of('/');
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+  }
+
+  inline bool GetDirectory(const std::string& path, const std::string& mask, std::vector<CDirEntry>& items)
+  {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr)
+      return false;
+
+    while (const dirent* entry = readdir(dir))
+    {
+      const std::string label = entry->d_name;
+      if (label == "." || label == "..")
+        continue;
+
+      const std::string entryPath = path + "/" + label;
+
+      struct stat st;
+      if (stat(entryPath.c_str(), &st) != 0)
+        continue;
+
+      items.emplace_back(label, entryPath, S_ISDIR(st.st_mode), static_cast<int64_t>(st.st_size));
+    }
+
+    closedir(dir);
+    return true;
+  }
+
+  class CFile
+  {
+  public:
+    CFile() = default;
+    ~CFile() { Close(); }
+
+    CFile(const CFile&) = delete;
+    CFile& operator=(const CFile&) = delete;
+
+    bool OpenFile(const std::string& filename, unsigned int flags = 0)
+    {
+      Close();
+      m_file = fopen(filename.c_str(), "rb");
+      return m_file != nullptr;
+    }
+
+    bool OpenFileForWrite(const std::string& filename, bool overwrite = false)
+    {
+      Close();
+      if (!overwrite)
+        m_file = fopen(filename.c_str(), "r+b");
+      if (m_file == nullptr)
+        m_file = fopen(filename.c_str(), "w+b");
+      return m_file != nullptr;
+    }
+
+    bool IsOpen() const { return m_file != nullptr; }
+
+    void Close()
+    {
+      if (m_file != nullptr)
+      {
+        fclose(m_file);
+        m_file = nullptr;
+      }
+    }
+
+    ssize_t Read(void* ptr, size_t size)
+    {
+      if (m_file == nullptr)
+        return -1;
+
+      const size_t read = fread(ptr, 1, size, m_file);
+      return read == 0 && ferror(m_file) ? -1 : static_cast<ssize_t>(read);
+    }
+
+    ssize_t Write(const void* ptr, size_t size)
+    {
+      if (m_file == nullptr)
+        return -1;
+
+      const size_t written = fwrite(ptr, 1, size, m_file);
+      return written == 0 && size > 0 ? -1 : static_cast<ssize_t>(written);
+    }
+
+    void Flush()
+    {
+      if (m_file != nullptr)
+        fflush(m_file);
+    }
+
+    int64_t Seek(int64_t position, int whence = SEEK_SET)
+    {
+      if (m_file == nullptr || fseeko(m_file, static_cast<off_t>(position), whence) != 0)
+        return -1;
+
+      return GetPosition();
+    }
+
+    int Truncate(int64_t size)
+    {
+      if (m_file == nullptr)
+        return -1;
+
+      fflush(m_file);
+      return ftruncate(fileno(m_file), static_cast<off_t>(size));
+    }
+
+    int64_t GetPosition() const
+    {
+      return m_file != nullptr ? static_cast<int64_t>(ftello(m_file)) : -1;
+    }
+
+    int64_t GetLength() const
+    {
+      if (m_file == nullptr)
+        return -1;
+
+      fflush(m_file);
+
+      struct stat st;
+      if (fstat(fileno(m_file), &st) != 0)
+        return -1;
+
+      return static_cast<int64_t>(st.st_size);
+    }
+
+  private:
+    FILE* m_file = nullptr;
+  };
+}
+}
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Stand-in for Kodi's notifications. Messages meant for the user are
+ * printed to stderr.
+ */
+
+#include "AddonBase.h"
+
+typedef enum QueueMsg
+{
+  QUEUE_INFO,
+  QUEUE_WARNING,
+  QUEUE_ERROR,
+  QUEUE_OWN_STYLE
+} QueueMsg;
+
+namespace kodi
+{
+  inline void QueueFormattedNotification(QueueMsg type, const char* format, ...)
+  {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+  }
+
+  inline void QueueNotification(QueueMsg type, const std::string& header, const std::string& message)
+  {
+    fprintf(stderr, "%s: %s\n", header.c_str(), message.c_str());
+  }
+}
@@ -0,0 +1,437 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Stand-in for Kodi's Game API. The types match the dev-kit, and the calls
+ * an add-on makes into Kodi, including the streams, are implemented by the
+ * bench frontend.
+ */
+
+#include "../AddonBase.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+typedef enum GAME_ERROR
+{
+  GAME_ERROR_NO_ERROR,
+  GAME_ERROR_UNKNOWN,
+  GAME_ERROR_NOT_IMPLEMENTED,
+  GAME_ERROR_REJECTED,
+  GAME_ERROR_INVALID_PARAMETERS,
+  GAME_ERROR_FAILED,
+  GAME_ERROR_NOT_LOADED,
+  GAME_ERROR_RESTRICTED,
+} GAME_ERROR;
+
+typedef enum GAME_PCM_FORMAT
+{
+  GAME_PCM_FORMAT_UNKNOWN,
+  GAME_PCM_FORMAT_S16NE,
+} GAME_PCM_FORMAT;
+
+typedef enum GAME_AUDIO_CHANNEL
+{
+  GAME_CH_NULL,
+  GAME_CH_FL,
+  GAME_CH_FR,
+  GAME_CH_FC,
+  GAME_CH_LFE,
+  GAME_CH_BL,
+  GAME_CH_BR,
+  GAME_CH_FLOC,
+  GAME_CH_FROC,
+  GAME_CH_BC,
+  GAME_CH_SL,
+  GAME_CH_SR,
+  GAME_CH_TFL,
+  GAME_CH_TFR,
+  GAME_CH_TFC,
+  GAME_CH_TC,
+  GAME_CH_TBL,
+  GAME_CH_TBR,
+  GAME_CH_TBC,
+  GAME_CH_BLOC,
+  GAME_CH_BROC,
+} GAME_AUDIO_CHANNEL;
+
+typedef struct game_stream_audio_properties
+{
+  GAME_PCM_FORMAT format;
+  const GAME_AUDIO_CHANNEL* channel_map;
+} game_stream_audio_properties;
+
+typedef struct game_stream_audio_packet
+{
+  const uint8_t* data;
+  size_t size;
+} game_stream_audio_packet;
+
+typedef enum GAME_PIXEL_FORMAT
+{
+  GAME_PIXEL_FORMAT_UNKNOWN,
+  GAME_PIXEL_FORMAT_0RGB8888,
+  GAME_PIXEL_FORMAT_RGB565,
+  GAME_PIXEL_FORMAT_0RGB1555,
+} GAME_PIXEL_FORMAT;
+
+typedef enum GAME_VIDEO_ROTATION
+{
+  GAME_VIDEO_ROTATION_0,
+  GAME_VIDEO_ROTATION_90_CCW,
+  GAME_VIDEO_ROTATION_180_CCW,
+  GAME_VIDEO_ROTATION_270_CCW,
+} GAME_VIDEO_ROTATION;
+
+typedef struct game_stream_video_properties
+{
+  GAME_PIXEL_FORMAT format;
+  unsigned int nominal_width;
+  unsigned int nominal_height;
+  unsigned int max_width;
+  unsigned int max_height;
+  float aspect_ratio;
+} game_stream_video_properties;
+
+typedef struct game_stream_video_packet
+{
+  unsigned int width;
+  unsigned int height;
+  GAME_VIDEO_ROTATION rotation;
+  const uint8_t* data;
+  size_t size;
+} game_stream_video_packet;
+
+typedef enum GAME_HW_CONTEXT_TYPE
+{
+  GAME_HW_CONTEXT_NONE,
+  GAME_HW_CONTEXT_OPENGL,
+  GAME_HW_CONTEXT_OPENGLES2,
+  GAME_HW_CONTEXT_OPENGL_CORE,
+  GAME_HW_CONTEXT_OPENGLES3,
+  GAME_HW_CONTEXT_OPENGLES_VERSION,
+  GAME_HW_CONTEXT_VULKAN,
+} GAME_HW_CONTEXT_TYPE;
+
+typedef struct game_stream_hw_framebuffer_properties
+{
+  GAME_HW_CONTEXT_TYPE context_type;
+  bool depth;
+  bool stencil;
+  bool bottom_left_origin;
+  unsigned int version_major;
+  unsigned int version_minor;
+  bool cache_context;
+  bool debug_context;
+} game_stream_hw_framebuffer_properties;
+
+typedef struct game_stream_hw_framebuffer_buffer
+{
+  uintptr_t framebuffer;
+} game_stream_hw_framebuffer_buffer;
+
+typedef struct game_stream_hw_framebuffer_packet
+{
+  uintptr_t framebuffer;
+} game_stream_hw_framebuffer_packet;
+
+typedef game_stream_video_properties game_stream_sw_framebuffer_properties;
+
+typedef struct game_stream_sw_framebuffer_buffer
+{
+  GAME_PIXEL_FORMAT format;
+  uint8_t* data;
+  size_t size;
+} game_stream_sw_framebuffer_buffer;
+
+typedef game_stream_video_packet game_stream_sw_framebuffer_packet;
+
+typedef enum GAME_STREAM_TYPE
+{
+  GAME_STREAM_UNKNOWN,
+  GAME_STREAM_AUDIO,
+  GAME_STREAM_VIDEO,
+  GAME_STREAM_HW_FRAMEBUFFER,
+  GAME_STREAM_SW_FRAMEBUFFER,
+} GAME_STREAM_TYPE;
+
+typedef struct game_stream_properties
+{
+  GAME_STREAM_TYPE type;
+  union
+  {
+    game_stream_audio_properties audio;
+    game_stream_video_properties video;
+    game_stream_hw_framebuffer_properties hw_framebuffer;
+    game_stream_sw_framebuffer_properties sw_framebuffer;
+  };
+} game_stream_properties;
+
+typedef struct game_stream_buffer
+{
+  GAME_STREAM_TYPE type;
+  union
+  {
+    game_stream_hw_framebuffer_buffer hw_framebuffer;
+    game_stream_sw_framebuffer_buffer sw_framebuffer;
+  };
+} game_stream_buffer;
+
+typedef struct game_stream_packet
+{
+  GAME_STREAM_TYPE type;
+  union
+  {
+    game_stream_audio_packet audio;
+    game_stream_video_packet video;
+    game_stream_hw_framebuffer_packet hw_framebuffer;
+    game_stream_sw_framebuffer_packet sw_framebuffer;
+  };
+} game_stream_packet;
+
+typedef enum GAME_REGION
+{
+  GAME_REGION_UNKNOWN,
+  GAME_REGION_NTSC,
+  GAME_REGION_PAL,
+} GAME_REGION;
+
+typedef enum SPECIAL_GAME_TYPE
+{
+  SPECIAL_GAME_TYPE_BSX,
+  SPECIAL_GAME_TYPE_BSX_SLOTTED,
+  SPECIAL_GAME_TYPE_SUFAMI_TURBO,
+  SPECIAL_GAME_TYPE_SUPER_GAMEBOY,
+} SPECIAL_GAME_TYPE;
+
+typedef enum GAME_MEMORY
+{
+  GAME_MEMORY_MASK = 0xff,
+  GAME_MEMORY_SAVE_RAM = 0,
+  GAME_MEMORY_RTC = 1,
+  GAME_MEMORY_SYSTEM_RAM = 2,
+  GAME_MEMORY_VIDEO_RAM = 3,
+  GAME_MEMORY_SNES_BSX_RAM = ((1 << 8) | GAME_MEMORY_SAVE_RAM),
+  GAME_MEMORY_SNES_BSX_PRAM = ((2 << 8) | GAME_MEMORY_SAVE_RAM),
+  GAME_MEMORY_SNES_SUFAMI_TURBO_A_RAM = ((3 << 8) | GAME_MEMORY_SAVE_RAM),
+  GAME_MEMORY_SNES_SUFAMI_TURBO_B_RAM = ((4 << 8) | GAME_MEMORY_SAVE_RAM),
+  GAME_MEMORY_SNES_GAME_BOY_RAM = ((5 << 8) | GAME_MEMORY_SAVE_RAM),
+  GAME_MEMORY_SNES_GAME_BOY_RTC = ((6 << 8) | GAME_MEMORY_RTC),
+} GAME_MEMORY;
+
+typedef enum GAME_INPUT_EVENT_SOURCE
+{
+  GAME_INPUT_EVENT_DIGITAL_BUTTON,
+  GAME_INPUT_EVENT_ANALOG_BUTTON,
+  GAME_INPUT_EVENT_AXIS,
+  GAME_INPUT_EVENT_ANALOG_STICK,
+  GAME_INPUT_EVENT_ACCELEROMETER,
+  GAME_INPUT_EVENT_KEY,
+  GAME_INPUT_EVENT_RELATIVE_POINTER,
+  GAME_INPUT_EVENT_ABSOLUTE_POINTER,
+  GAME_INPUT_EVENT_MOTOR,
+} GAME_INPUT_EVENT_SOURCE;
+
+typedef enum GAME_KEY_MOD
+{
+  GAME_KEY_MOD_NONE = 0x0000,
+  GAME_KEY_MOD_SHIFT = 0x0001,
+  GAME_KEY_MOD_CTRL = 0x0002,
+  GAME_KEY_MOD_ALT = 0x0004,
+  GAME_KEY_MOD_META = 0x0008,
+  GAME_KEY_MOD_SUPER = 0x0010,
+  GAME_KEY_MOD_NUMLOCK = 0x0100,
+  GAME_KEY_MOD_CAPSLOCK = 0x0200,
+  GAME_KEY_MOD_SCROLLOCK = 0x0400,
+} GAME_KEY_MOD;
+
+typedef enum GAME_PORT_TYPE
+{
+  GAME_PORT_UNKNOWN,
+  GAME_PORT_KEYBOARD,
+  GAME_PORT_MOUSE,
+  GAME_PORT_CONTROLLER,
+} GAME_PORT_TYPE;
+
+struct game_input_port;
+
+typedef struct game_input_device
+{
+  const char* controller_id;
+  game_input_port* available_ports;
+  unsigned int port_count;
+} game_input_device;
+
+typedef struct game_input_port
+{
+  GAME_PORT_TYPE type;
+  const char* port_id;
+  bool force_connected;
+  game_input_device* accepted_devices;
+  unsigned int device_count;
+} game_input_port;
+
+typedef struct game_input_topology
+{
+  game_input_port* ports;
+  unsigned int port_count;
+  int player_limit;
+} game_input_topology;
+
+typedef struct game_digital_button_event
+{
+  bool pressed;
+} game_digital_button_event;
+
+typedef struct game_analog_button_event
+{
+  float magnitude;
+} game_analog_button_event;
+
+typedef struct game_axis_event
+{
+  float position;
+} game_axis_event;
+
+typedef struct game_analog_stick_event
+{
+  float x;
+  float y;
+} game_analog_stick_event;
+
+typedef struct game_accelerometer_event
+{
+  float x;
+  float y;
+  float z;
+} game_accelerometer_event;
+
+typedef struct game_key_event
+{
+  bool pressed;
+  uint32_t unicode;
+  GAME_KEY_MOD modifiers;
+} game_key_event;
+
+typedef struct game_rel_pointer_event
+{
+  int x;
+  int y;
+} game_rel_pointer_event;
+
+typedef struct game_abs_pointer_event
+{
+  bool pressed;
+  float x;
+  float y;
+} game_abs_pointer_event;
+
+typedef struct game_motor_event
+{
+  float magnitude;
+} game_motor_event;
+
+typedef struct game_input_event
+{
+  GAME_INPUT_EVENT_SOURCE type;
+  const char* controller_id;
+  GAME_PORT_TYPE port_type;
+  const char* port_address;
+  const char* feature_name;
+  union
+  {
+    game_digital_button_event digital_button;
+    game_analog_button_event analog_button;
+    game_axis_event axis;
+    game_analog_stick_event analog_stick;
+    game_accelerometer_event accelerometer;
+    game_key_event key;
+    game_rel_pointer_event rel_pointer;
+    game_abs_pointer_event abs_pointer;
+    game_motor_event motor;
+  };
+} game_input_event;
+
+typedef struct game_system_timing
+{
+  double fps;
+  double sample_rate;
+} game_system_timing;
+
+#define DEFAULT_PORT_ID "1"
+
+typedef void* KODI_GAME_STREAM_HANDLE;
+
+typedef void (*game_proc_address_t)(void);
+
+namespace kodi
+{
+namespace addon
+{
+  class GameControllerLayout
+  {
+  public:
+    std::string controller_id;
+    bool provides_input = false;
+    std::vector<std::string> digital_buttons;
+    std::vector<std::string> analog_buttons;
+    std::vector<std::string> analog_sticks;
+    std::vector<std::string> accelerometers;
+    std::vector<std::string> keys;
+    std::vector<std::string> rel_pointers;
+    std::vector<std::string> abs_pointers;
+    std::vector<std::string> motors;
+  };
+
+  /*!
+   * \brief The calls a game add-on makes into Kodi
+   *
+   * The add-on's callbacks (LoadGame(), RunFrame(), ...) are left out, as
+   * the benchmark drives the core directly. Everything here is implemented
+   * by the bench frontend.
+   */
+  class CInstanceGame
+  {
+  public:
+    CInstanceGame() = default;
+    virtual ~CInstanceGame() = default;
+
+    std::string GameClientDllPath() const;
+    bool ResourceDirectories(std::vector<std::string>& dirs) const;
+    std::string ProfileDirectory() const;
+    bool SupportsVFS() const;
+
+    void CloseGame();
+    game_proc_address_t HwGetProcAddress(const char* sym);
+    bool KodiInputEvent(const game_input_event& event);
+
+    class CStream
+    {
+    public:
+      CStream() = default;
+      ~CStream() { Close(); }
+
+      CStream(const CStream&) = delete;
+      CStream& operator=(const CStream&) = delete;
+
+      bool Open(const game_stream_properties& properties);
+      void Close();
+      bool GetBuffer(unsigned int width, unsigned int height, game_stream_buffer& buffer);
+      void AddData(const game_stream_packet& packet);
+      void ReleaseBuffer(game_stream_buffer& buffer);
+      bool IsOpen() const { return m_handle != nullptr; }
+
+    private:
+      KODI_GAME_STREAM_HANDLE m_handle = nullptr;
+    };
+  };
+}
+}
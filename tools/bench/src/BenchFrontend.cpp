@@ -0,0 +1,248 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "BenchFrontend.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace LIBRETRO;
+
+namespace
+{
+  size_t BytesPerPixel(GAME_PIXEL_FORMAT format)
+  {
+    switch (format)
+    {
+    case GAME_PIXEL_FORMAT_0RGB8888:
+      return 4;
+    case GAME_PIXEL_FORMAT_RGB565:
+    case GAME_PIXEL_FORMAT_0RGB1555:
+      return 2;
+    default:
+      break;
+    }
+    return 0;
+  }
+}
+
+CBenchFrontend& CBenchFrontend::Get()
+{
+  static CBenchFrontend _instance;
+  return _instance;
+}
+
+bool CBenchFrontend::GetCoreOption(const std::string& key, std::string& value) const
+{
+  auto it = m_coreOptions.find(key);
+  if (it == m_coreOptions.end())
+    return false;
+
+  value = it->second;
+  return true;
+}
+
+KODI_GAME_STREAM_HANDLE CBenchFrontend::OpenStream(const game_stream_properties& properties)
+{
+  std::unique_ptr<BenchStream> stream(new BenchStream);
+  stream->type = properties.type;
+
+  switch (properties.type)
+  {
+  case GAME_STREAM_AUDIO:
+    break;
+  case GAME_STREAM_VIDEO:
+    stream->format = properties.video.format;
+    break;
+  case GAME_STREAM_SW_FRAMEBUFFER:
+    stream->format = properties.sw_framebuffer.format;
+    break;
+  case GAME_STREAM_HW_FRAMEBUFFER:
+    esyslog("Hardware rendering is not supported");
+    return nullptr;
+  default:
+    return nullptr;
+  }
+
+  return stream.release();
+}
+
+void CBenchFrontend::CloseStream(KODI_GAME_STREAM_HANDLE handle)
+{
+  delete static_cast<BenchStream*>(handle);
+}
+
+bool CBenchFrontend::GetStreamBuffer(KODI_GAME_STREAM_HANDLE handle, unsigned int width, unsigned int height, game_stream_buffer& buffer)
+{
+  BenchStream* stream = static_cast<BenchStream*>(handle);
+
+  if (stream->type != GAME_STREAM_SW_FRAMEBUFFER)
+    return false;
+
+  const size_t size = BytesPerPixel(stream->format) * width * height;
+  if (size == 0)
+    return false;
+
+  std::unique_ptr<std::vector<uint8_t>> data;
+  if (!stream->freeBuffers.empty())
+  {
+    data = std::move(stream->freeBuffers.back());
+    stream->freeBuffers.pop_back();
+  }
+  else
+  {
+    data.reset(new std::vector<uint8_t>);
+  }
+
+  data->resize(size);
+
+  buffer.type = GAME_STREAM_SW_FRAMEBUFFER;
+  buffer.sw_framebuffer.format = stream->format;
+  buffer.sw_framebuffer.data = data->data();
+  buffer.sw_framebuffer.size = size;
+
+  stream->usedBuffers.emplace_back(std::move(data));
+
+  return true;
+}
+
+void CBenchFrontend::AddStreamData(KODI_GAME_STREAM_HANDLE handle, const game_stream_packet& packet)
+{
+  switch (packet.type)
+  {
+  case GAME_STREAM_AUDIO:
+  {
+    m_scratch.assign(packet.audio.data, packet.audio.data + packet.audio.size);
+    m_output.audioPackets++;
+    m_output.audioBytes += packet.audio.size;
+    break;
+  }
+  case GAME_STREAM_VIDEO:
+  {
+    m_scratch.assign(packet.video.data, packet.video.data + packet.video.size);
+    m_output.videoFrames++;
+    m_output.videoBytes += packet.video.size;
+    break;
+  }
+  case GAME_STREAM_SW_FRAMEBUFFER:
+  {
+    // Kodi renders straight from the framebuffer it handed out
+    m_output.videoFrames++;
+    m_output.framebuffers++;
+    m_output.videoBytes += packet.sw_framebuffer.size;
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void CBenchFrontend::ReleaseStreamBuffer(KODI_GAME_STREAM_HANDLE handle, game_stream_buffer& buffer)
+{
+  BenchStream* stream = static_cast<BenchStream*>(handle);
+
+  if (buffer.type != GAME_STREAM_SW_FRAMEBUFFER)
+    return;
+
+  auto it = std::find_if(stream->usedBuffers.begin(), stream->usedBuffers.end(),
+    [&buffer](const std::unique_ptr<std::vector<uint8_t>>& data)
+    {
+      return data->data() == buffer.sw_framebuffer.data;
+    });
+
+  if (it != stream->usedBuffers.end())
+  {
+    stream->freeBuffers.emplace_back(std::move(*it));
+    stream->usedBuffers.erase(it);
+  }
+}
+
+// --- Game API calls into Kodi ------------------------------------------------
+
+namespace kodi
+{
+namespace addon
+{
+  bool CheckSettingString(const std::string& settingName, std::string& settingValue)
+  {
+    return CBenchFrontend::Get().GetCoreOption(settingName, settingValue);
+  }
+
+  std::string CInstanceGame::GameClientDllPath() const
+  {
+    return "";
+  }
+
+  bool CInstanceGame::ResourceDirectories(std::vector<std::string>& dirs) const
+  {
+    dirs.push_back(CBenchFrontend::Get().Directory());
+    return true;
+  }
+
+  std::string CInstanceGame::ProfileDirectory() const
+  {
+    return CBenchFrontend::Get().Directory();
+  }
+
+  bool CInstanceGame::SupportsVFS() const
+  {
+    return false;
+  }
+
+  void CInstanceGame::CloseGame()
+  {
+    CBenchFrontend::Get().CloseGame();
+  }
+
+  game_proc_address_t CInstanceGame::HwGetProcAddress(const char* sym)
+  {
+    return nullptr;
+  }
+
+  bool CInstanceGame::KodiInputEvent(const game_input_event& event)
+  {
+    return false;
+  }
+
+  bool CInstanceGame::CStream::Open(const game_stream_properties& properties)
+  {
+    Close();
+    m_handle = CBenchFrontend::Get().OpenStream(properties);
+    return m_handle != nullptr;
+  }
+
+  void CInstanceGame::CStream::Close()
+  {
+    if (m_handle != nullptr)
+    {
+      CBenchFrontend::Get().CloseStream(m_handle);
+      m_handle = nullptr;
+    }
+  }
+
+  bool CInstanceGame::CStream::GetBuffer(unsigned int width, unsigned int height, game_stream_buffer& buffer)
+  {
+    if (m_handle == nullptr)
+      return false;
+
+    return CBenchFrontend::Get().GetStreamBuffer(m_handle, width, height, buffer);
+  }
+
+  void CInstanceGame::CStream::AddData(const game_stream_packet& packet)
+  {
+    if (m_handle != nullptr)
+      CBenchFrontend::Get().AddStreamData(m_handle, packet);
+  }
+
+  void CInstanceGame::CStream::ReleaseBuffer(game_stream_buffer& buffer)
+  {
+    if (m_handle != nullptr)
+      CBenchFrontend::Get().ReleaseStreamBuffer(m_handle, buffer);
+  }
+}
+}
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/addon-instance/Game.h>
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace LIBRETRO
+{
+  /*!
+   * \brief Output received from the add-on, counted by the stand-in frontend
+   */
+  struct BenchOutput
+  {
+    uint64_t videoFrames = 0;
+    uint64_t videoBytes = 0;
+    uint64_t framebuffers = 0;
+    uint64_t audioPackets = 0;
+    uint64_t audioBytes = 0;
+  };
+
+  /*!
+   * \brief In-process stand-in for the Kodi side of the Game API
+   *
+   * Implements the calls the add-on makes into Kodi. Streams accept video
+   * and audio the way Kodi does: packets are copied out of the add-on's
+   * buffers, and software framebuffers are handed out from a pool. Hardware
+   * rendering is refused, as there is no display.
+   */
+  class CBenchFrontend
+  {
+  private:
+    CBenchFrontend() = default;
+
+  public:
+    static CBenchFrontend& Get();
+
+    /*!
+     * \brief Set the directory reported as the add-on's resource and
+     *        profile directory
+     */
+    void SetDirectory(const std::string& directory) { m_directory = directory; }
+    const std::string& Directory() const { return m_directory; }
+
+    /*!
+     * \brief Set a core option, overriding its default value
+     */
+    void SetCoreOption(const std::string& key, const std::string& value) { m_coreOptions[key] = value; }
+    bool GetCoreOption(const std::string& key, std::string& value) const;
+
+    /*!
+     * \brief Called when the core asks to shut down
+     */
+    void CloseGame() { m_bGameClosed = true; }
+    bool IsGameClosed() const { return m_bGameClosed; }
+
+    const BenchOutput& Output() const { return m_output; }
+    void ResetOutput() { m_output = BenchOutput(); }
+
+    // Stream implementation for kodi::addon::CInstanceGame::CStream
+    KODI_GAME_STREAM_HANDLE OpenStream(const game_stream_properties& properties);
+    void CloseStream(KODI_GAME_STREAM_HANDLE handle);
+    bool GetStreamBuffer(KODI_GAME_STREAM_HANDLE handle, unsigned int width, unsigned int height, game_stream_buffer& buffer);
+    void AddStreamData(KODI_GAME_STREAM_HANDLE handle, const game_stream_packet& packet);
+    void ReleaseStreamBuffer(KODI_GAME_STREAM_HANDLE handle, game_stream_buffer& buffer);
+
+  private:
+    struct BenchStream
+    {
+      GAME_STREAM_TYPE type = GAME_STREAM_UNKNOWN;
+      GAME_PIXEL_FORMAT format = GAME_PIXEL_FORMAT_UNKNOWN;
+      std::vector<std::unique_ptr<std::vector<uint8_t>>> freeBuffers;
+      std::vector<std::unique_ptr<std::vector<uint8_t>>> usedBuffers;
+    };
+
+    std::string m_directory = ".";
+    std::map<std::string, std::string> m_coreOptions;
+    bool m_bGameClosed = false;
+
+    // Stands in for the copy Kodi makes of each video and audio packet
+    std::vector<uint8_t> m_scratch;
+    BenchOutput m_output;
+  };
+}
@@ -0,0 +1,20 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+/*
+ * Stand-in for the add-on's client.h. The add-on sources only reach the
+ * add-on through the Game API calls of CInstanceGame, so the benchmark
+ * doesn't need the real frame loop of CGameLibRetro.
+ */
+
+#include <kodi/addon-instance/Game.h>
+
+class ATTR_DLL_LOCAL CGameLibRetro : public kodi::addon::CInstanceGame
+{
+};
@@ -0,0 +1,386 @@
+/*
+ *  Copyright (C) 2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "BenchFrontend.h"
+#include "frameloop/CoreRunner.h"
+#include "input/ButtonMapper.h"
+#include "input/ControllerTopology.h"
+#include "libretro/ClientBridge.h"
+#include "libretro/CpuFeatures.h"
+#include "libretro/LibretroDLL.h"
+#include "libretro/LibretroEnvironment.h"
+#include "libretro/PerfCounters.h"
+#include "log/Log.h"
+#include "settings/Settings.h"
+#include "utils/FrameProfiler.h"
+#include "utils/Histogram.h"
+#include "utils/Timer.h"
+#include "video/PixelConverter.h"
+#include "client.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace LIBRETRO;
+
+namespace
+{
+  struct BenchOptions
+  {
+    std::string corePath;
+    std::string contentPath;
+    std::string directory = ".";
+    unsigned int frames = 1000;
+    unsigned int warmupFrames = 60;
+    bool bVerbose = false;
+    bool bPixelConverters = false;
+    std::vector<std::pair<std::string, std::string>> coreOptions;
+    std::vector<std::pair<std::string, std::string>> addonSettings;
+  };
+
+  void PrintUsage(const char* program)
+  {
+    fprintf(stderr,
+        "Usage: %s [options] <core> [content]\n"
+        "       %s -p [-n <frames>]\n"
+        "\n"
+        "Runs a libretro core headless through the add-on's frontend code and\n"
+        "reports its performance, or benchmarks the add-on's pixel format\n"
+        "converters (-p).\n"
+        "\n"
+        "Options:\n"
+        "  -n <frames>       Number of frames to measure (default: 1000)\n"
+        "  -w <frames>       Number of frames to run before measuring (default: 60)\n"
+        "  -s <directory>    Add-on directory: system files are read from\n"
+        "                    <directory>/system, saves go to <directory>/save\n"
+        "                    (default: .)\n"
+        "  -o <key>=<value>  Set a core option (can be repeated)\n"
+        "  -a <id>=<value>   Set an add-on setting, e.g. cropoverscan=true\n"
+        "                    (can be repeated)\n"
+        "  -v                Show debug logging\n"
+        "  -p                Benchmark pixel format conversion instead of a core\n",
+        program, program);
+  }
+
+  bool ParseKeyValue(const std::string& option, std::vector<std::pair<std::string, std::string>>& values)
+  {
+    const size_t pos = option.find('=');
+    if (pos == std::string::npos)
+      return false;
+
+    values.emplace_back(option.substr(0, pos), option.substr(pos + 1));
+    return true;
+  }
+
+  bool ParseOptions(int argc, char** argv, BenchOptions& options)
+  {
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string arg = argv[i];
+      const bool bHasValue = (i + 1 < argc);
+
+      if (arg == "-n" && bHasValue)
+        options.frames = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "-w" && bHasValue)
+        options.warmupFrames = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+      else if (arg == "-s" && bHasValue)
+        options.directory = argv[++i];
+      else if (arg == "-o" && bHasValue)
+      {
+        if (!ParseKeyValue(argv[++i], options.coreOptions))
+          return false;
+      }
+      else if (arg == "-a" && bHasValue)
+      {
+        if (!ParseKeyValue(argv[++i], options.addonSettings))
+          return false;
+      }
+      else if (arg == "-v")
+        options.bVerbose = true;
+      else if (arg == "-p")
+        options.bPixelConverters = true;
+      else if (!arg.empty() && arg[0] == '-')
+        return false;
+      else
+        positional.push_back(arg);
+    }
+
+    if (options.frames == 0)
+      return false;
+
+    if (options.bPixelConverters)
+      return positional.empty();
+
+    if (positional.empty() || positional.size() > 2)
+      return false;
+
+    options.corePath = positional[0];
+    if (positional.size() > 1)
+      options.contentPath = positional[1];
+
+    return true;
+  }
+
+  bool LoadContent(CLibretroDLL& client, const BenchOptions& options, std::vector<char>& contentData)
+  {
+    if (options.contentPath.empty())
+      return client.retro_load_game(nullptr);
+
+    retro_system_info systemInfo = { };
+    client.retro_get_system_info(&systemInfo);
+
+    retro_game_info gameInfo = { };
+    gameInfo.path = options.contentPath.c_str();
+
+    if (!systemInfo.need_fullpath)
+    {
+      std::ifstream file(options.contentPath, std::ios::binary);
+      if (!file)
+      {
+        esyslog("Failed to open %s", options.contentPath.c_str());
+        return false;
+      }
+
+      contentData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      gameInfo.data = contentData.data();
+      gameInfo.size = contentData.size();
+    }
+
+    return client.retro_load_game(&gameInfo);
+  }
+
+  void PrintReport(unsigned int frames,
+                   const retro_system_av_info& avInfo,
+                   const CHistogram& frameTimes,
+                   uint64_t elapsedNs,
+                   const BenchOutput& output)
+  {
+    const double elapsedSec = elapsedNs / 1000000000.0;
+    const double fps = frames / elapsedSec;
+    const double coreFps = avInfo.timing.fps;
+
+    printf("Frames:         %u in %.3f s\n", frames, elapsedSec);
+    printf("Speed:          %.1f fps", fps);
+    if (coreFps > 0.0)
+      printf(" (%.2fx realtime at %.2f fps)", fps / coreFps, coreFps);
+    printf("\n");
+    printf("Frame time:     p50 %.3f ms  p90 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+        frameTimes.Percentile(0.50) / 1000000.0,
+        frameTimes.Percentile(0.90) / 1000000.0,
+        frameTimes.Percentile(0.99) / 1000000.0,
+        frameTimes.Max() / 1000000.0);
+    printf("Video:          %llu frames (%llu in framebuffers), %llu bytes\n",
+        static_cast<unsigned long long>(output.videoFrames),
+        static_cast<unsigned long long>(output.framebuffers),
+        static_cast<unsigned long long>(output.videoBytes));
+    printf("Audio:          %llu packets, %llu bytes\n",
+        static_cast<unsigned long long>(output.audioPackets),
+        static_cast<unsigned long long>(output.audioBytes));
+  }
+
+  int RunPixelConverterBenchmark(const BenchOptions& options)
+  {
+    // A typical frame size for 16-bit cores, with some padding in the pitch
+    const unsigned int width = 640;
+    const unsigned int height = 480;
+    const size_t pitch = width * 2 + 64;
+
+    std::vector<uint8_t> frame(pitch * height);
+    uint32_t seed = 1;
+    for (uint8_t& byte : frame)
+    {
+      seed = seed * 1103515245 + 12345;
+      byte = static_cast<uint8_t>(seed >> 16);
+    }
+
+    static const struct
+    {
+      const char* name;
+      bool bRGB565;
+    } formats[] = {
+      { "RGB565", true },
+      { "0RGB1555", false },
+    };
+
+    int result = 0;
+
+    for (const auto& format : formats)
+    {
+      // The scalar kernel is the reference for the others
+      CPixelConverter reference;
+      if (format.bRGB565)
+        reference.ConvertRGB565(frame.data(), width, height, pitch);
+      else
+        reference.Convert0RGB1555(frame.data(), width, height, pitch);
+
+      for (unsigned int i = 0; i < PIXEL_KERNEL_COUNT; i++)
+      {
+        const PIXEL_KERNEL kernel = static_cast<PIXEL_KERNEL>(i);
+
+        CPixelConverter converter;
+        if (!converter.SetKernel(kernel))
+          continue;
+
+        Timer timer;
+        const uint64_t startNs = timer.nanoseconds();
+
+        for (unsigned int frameIndex = 0; frameIndex < options.frames; frameIndex++)
+        {
+          if (format.bRGB565)
+            converter.ConvertRGB565(frame.data(), width, height, pitch);
+          else
+            converter.Convert0RGB1555(frame.data(), width, height, pitch);
+        }
+
+        const uint64_t elapsedNs = timer.nanoseconds() - startNs;
+
+        const bool bMatches = converter.Size() == reference.Size() &&
+                              memcmp(converter.Data(), reference.Data(), reference.Size()) == 0;
+        if (!bMatches)
+          result = 1;
+
+        printf("%-9s %-7s %8.1f Mpixels/s  %8.1f us/frame%s\n", format.name, CPixelConverter::KernelName(kernel),
+            static_cast<double>(width) * height * options.frames * 1000.0 / elapsedNs,
+            elapsedNs / 1000.0 / options.frames,
+            bMatches ? "" : "  MISMATCH");
+      }
+    }
+
+    return result;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  CLog::Get().SetType(SYS_LOG_TYPE_CONSOLE);
+  CLog::Get().SetLevel(options.bVerbose ? SYS_LOG_DEBUG : SYS_LOG_ERROR);
+
+  CCpuFeatures::Get().Detect();
+
+  if (options.bPixelConverters)
+    return RunPixelConverterBenchmark(options);
+
+  CBenchFrontend& frontend = CBenchFrontend::Get();
+  frontend.SetDirectory(options.directory);
+  for (const auto& coreOption : options.coreOptions)
+    frontend.SetCoreOption(coreOption.first, coreOption.second);
+
+  for (const auto& setting : options.addonSettings)
+    CSettings::Get().SetSetting(setting.first, kodi::addon::CSettingValue(setting.second));
+
+  // Set up the add-on as CGameLibRetro::Create() does
+  CLibretroDLL client;
+  if (!client.Load(options.corePath))
+    return 1;
+
+  if (client.retro_api_version() != 1)
+  {
+    esyslog("Expected libretro api v1, found version %u", client.retro_api_version());
+    return 1;
+  }
+
+  CGameLibRetro addon;
+  CClientBridge clientBridge;
+
+  CLibretroEnvironment::Get().InitializeEnvironment(&addon, &client, &clientBridge);
+
+  CButtonMapper::Get().LoadButtonMap();
+  CControllerTopology::GetInstance().LoadTopology();
+
+  client.retro_init();
+
+  CLibretroEnvironment::Get().InitializeCallbacks();
+
+  std::vector<char> contentData;
+  if (!LoadContent(client, options, contentData))
+  {
+    esyslog("Failed to load game");
+    client.retro_deinit();
+    CLibretroEnvironment::Get().Deinitialize();
+    return 1;
+  }
+
+  // Kodi queries the timing after loading, which opens the streams
+  retro_system_av_info avInfo = { };
+  client.retro_get_system_av_info(&avInfo);
+  CLibretroEnvironment::Get().UpdateVideoGeometry(avInfo.geometry);
+  CLibretroEnvironment::Get().UpdateTiming(avInfo.timing);
+
+  // Same as CGameLibRetro::RunFrame() without the optional frame loop
+  // strategies
+  auto runFrame = [&client]()
+  {
+    {
+      CFrameTimer frameTimer(FRAME_PHASE_FRAME);
+
+      CCoreRunner::Run(client);
+
+      CLibretroEnvironment::Get().OnFrameEnd();
+    }
+
+    CFrameProfiler::Get().OnFrameEnd();
+  };
+
+  for (unsigned int i = 0; i < options.warmupFrames && !frontend.IsGameClosed(); i++)
+    runFrame();
+
+  frontend.ResetOutput();
+
+  CFrameProfiler::Get().Reset();
+  CFrameProfiler::Get().SetEnabled(true);
+
+  Timer timer;
+  CHistogram frameTimes;
+
+  const uint64_t startNs = timer.nanoseconds();
+  uint64_t frameStartNs = startNs;
+
+  unsigned int frames = 0;
+  for (; frames < options.frames && !frontend.IsGameClosed(); frames++)
+  {
+    runFrame();
+
+    const uint64_t frameEndNs = timer.nanoseconds();
+    frameTimes.Add(frameEndNs - frameStartNs);
+    frameStartNs = frameEndNs;
+  }
+
+  if (frames < options.frames)
+    esyslog("Core shut down after %u frames", frames);
+
+  if (frames > 0)
+    PrintReport(frames, avInfo, frameTimes, frameStartNs - startNs, frontend.Output());
+
+  // Phase times and perf counters registered by the core go to the log
+  CLog::Get().SetLevel(SYS_LOG_INFO);
+  CFrameProfiler::Get().LogStatistics();
+  CPerfCounters::Get().Log();
+
+  client.retro_unload_game();
+  CLibretroEnvironment::Get().CloseStreams();
+  client.retro_deinit();
+
+  CPerfCounters::Get().Clear();
+  CControllerTopology::GetInstance().Clear();
+  CLibretroEnvironment::Get().Deinitialize();
+
+  return 0;
+}